@@ -0,0 +1,1963 @@
+/***
+ *        _                  _       ___ _   _    _   
+ *       /_\  _ _ __ __ _ __| |___  / __| |_(_)__| |__
+ *      / _ \| '_/ _/ _` / _` / -_) \__ \  _| / _| / /
+ *     /_/ \_\_| \__\__,_\__,_\___| |___/\__|_\__|_\_\
+ *                                                    
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>  /* for sei() */
+#include <util/delay.h>     /* for _delay_ms() */
+
+#include <avr/pgmspace.h>   /* required by usbdrv.h */
+#include "usbconfig.h"
+#include "usbdrv.h"
+#include <avr/eeprom.h> /* EEPROM functions */
+#include <stddef.h>     /* for offsetof() */
+#include <string.h>     /* for memcmp() */
+
+#define EEPROM_DEF 0xFF /* for uninitialized EEPROMs */
+
+#include "pinAssignment.h" /* board dependent pin configuration */
+#include "InputCore.h"     /* input snapshot, SOCD, autofire and report */
+
+/* 
+Configuration Mode
+==================
+In the configuration mode the behaviour of the Dual Strike can be changed,
+see Startup Behaviour for how to enter it. Leave it by pressing Start.
+
+While in configuration mode pressing a button and/or a joystick
+direction, changes part of the configuration:
+
+Dual Strike default stick mode:
+-------------------------------
+Up    = digital pad only (precedence over Left and Right) [default]
+Left  = left analogue stick only
+Right = right analogue stick only
+Down  = activate digital pad additionallly to left or right analogue stick
+
+Default Working Mode:
+---------------------
+Button: LK
+Left  = Dual Strike [default]
+Right = pass-through
+
+revert to defaults:
+-------------------
+Button: MK
+
+Start+Select=Home:
+------------------
+Button: LP
+Left  = disabled [default]
+Right = enabled
+
+SOCD Mode
+---------
+Not part of the configuration mode: hold the autofire action button (see
+Firmware variants) while the stick is plugged in and press
+Square   = SOCD policy of the flashed variant [default]
+Cross    = neutral
+Circle   = up priority
+Triangle = last input
+*/
+
+/*
+config byte description by bits:
+--------------------------------
+0:   default working mode (0 == Dual Strike; 1 == pass-through
+1:   Dual Strike left stick (0 == deactivated; 1 == activated)
+2:   Dual Strike digital pad (0 == deactivated; 1 == activated) => Default
+3:   Dual Strike right stick (0 == deactivated; 1 == activated)
+4:   Start+Select=Home (0 == disabled, 1 == enabled)
+5-6: SOCD mode, was extra PINs mode
+     (00 == variant default (SOCD_POLICY),
+	  01 == neutral,
+	  10 == up priority,
+	  11 == last input)
+7:   unused
+*/
+
+/*
+Firmware variants
+=================
+ArcadeStick1.c, ArcadeStick2.c and ArcadeStick3.c build this file and only
+choose the default SOCD policy (see SOCD resolution in InputCore.c) and the
+button that toggles autofire. The SOCD policy can be overridden at boot, see
+SOCD Mode; this file built on its own defaults to neutral:
+
+ArcadeStick1: neutral SOCD,     autofire toggled with Mode [default]
+ArcadeStick2: up priority SOCD, autofire toggled with Home
+ArcadeStick3: last input SOCD,  autofire toggled with Home
+*/
+
+#ifndef SOCD_POLICY
+#define SOCD_POLICY SOCD_NEUTRAL
+#endif
+
+// Macros for compatibility with MegaX8
+#ifndef TCCR0
+#define TCCR0 TCCR0B
+#endif
+
+#ifndef TIFR
+#define TIFR TIFR0
+#endif
+
+#ifndef EEMWE
+#define EEMWE EEMPE
+#endif
+
+#ifndef EEWE
+#define EEWE EEPE
+#endif
+
+#ifndef EE_RDY_vect
+#define EE_RDY_vect EE_READY_vect
+#endif
+
+#ifndef TIMER2_COMP_vect
+#define TIMER2_COMP_vect TIMER2_COMPA_vect
+#endif
+
+
+
+#define CONFIG_DEF 0b00000100 /* default config */
+uint8_t config = EEPROM_DEF;
+uint8_t config_EEPROM EEMEM = CONFIG_DEF; /* legacy single byte store, read once */
+
+// test configuration: default working mode == Dual Strike
+#define CFG_DEF_WORK_MODE_DS 	!(config & (1<<0))
+// test configuration:  Dual Strike left stick == enabled
+#define CFG_LEFT_STICK 			(config & (1<<1))
+// test configuration:  Dual Strike digital pad == enabled
+#define CFG_DIGITAL_PAD		    (config & (1<<2))
+// test configuration:  Dual Strike right stick == enabled
+#define CFG_RIGHT_STICK			(config & (1<<3))
+// test configuration: Start+Select=Home == enabled
+#define CFG_HOME_EMU		 	(config & (1<<4))
+// SOCD mode field, see SOCD resolution in InputCore.c
+#define CFG_SOCD_SHIFT			5
+#define CFG_SOCD_MASK			(0x03<<CFG_SOCD_SHIFT)
+#define CFG_SOCD_MODE			((config & CFG_SOCD_MASK) >> CFG_SOCD_SHIFT)
+
+
+// See pin definition in pinAssignment.h
+
+unsigned char SwitchMode;
+
+/* ------------------------------------------------------------------------- */
+/* ---------------------------- Input sampling ----------------------------- */
+/* ------------------------------------------------------------------------- */
+
+// The layout of the input snapshot is described in InputCore.h
+
+/*
+Reads PINB, PINC and PIND exactly once and builds the input snapshot from those
+copies. pinAssignment.h stays the compile-time pin map: while sampling, the
+PINx names are redirected to the latched bytes, so every Stick_* macro turns
+into a bit test on a register instead of another port read.
+*/
+void sampleInputs(input_t *in) {
+	uint8_t pinB = PINB;
+	uint8_t pinC = PINC;
+	uint8_t pinD = PIND;
+	uint16_t buttons = 0;
+	uint8_t dirs = 0;
+
+#pragma push_macro("PINB")
+#pragma push_macro("PINC")
+#pragma push_macro("PIND")
+#undef PINB
+#undef PINC
+#undef PIND
+#define PINB pinB
+#define PINC pinC
+#define PIND pinD
+
+	if (!Stick_Up)       dirs |= DIR_UP;
+	if (!Stick_Down)     dirs |= DIR_DOWN;
+	if (!Stick_Left)     dirs |= DIR_LEFT;
+	if (!Stick_Right)    dirs |= DIR_RIGHT;
+
+	if (!Stick_Square)   buttons |= BTN_SQUARE;
+	if (!Stick_Cross)    buttons |= BTN_CROSS;
+	if (!Stick_Circle)   buttons |= BTN_CIRCLE;
+	if (!Stick_Triangle) buttons |= BTN_TRIANGLE;
+#ifdef EXTRA_BUTTONS
+	if (!Stick_L1)       buttons |= BTN_L1;
+#endif
+	if (!Stick_R1)       buttons |= BTN_R1;
+#ifdef EXTRA_BUTTONS
+	if (!Stick_L2)       buttons |= BTN_L2;
+#endif
+	if (!Stick_R2)       buttons |= BTN_R2;
+	if (!Stick_Select)   buttons |= BTN_SELECT;
+	if (!Stick_Start)    buttons |= BTN_START;
+	if (!Stick_L3)       buttons |= BTN_L3;
+	if (!Stick_R3)       buttons |= BTN_R3;
+	if (!Stick_Home)     buttons |= BTN_HOME;
+#ifdef Stick_Mode
+	if (!Stick_Mode)     buttons |= BTN_MODE;
+#endif
+
+#pragma pop_macro("PIND")
+#pragma pop_macro("PINC")
+#pragma pop_macro("PINB")
+
+	in->buttons = buttons;
+	in->dirs = dirs;
+}
+
+/*
+Debounce
+========
+Every input has a 2-bit vertical counter: bit 0 of all inputs lives in cnt0,
+bit 1 in cnt1, so one step debounces all of them with a few AND/XOR ops.
+A counter runs while its input differs from the debounced state and is reset
+as soon as they agree; the state flips on the fourth step in a row. Steps are
+spaced so that four of them span DEBOUNCE_US, rounded to whole samples.
+
+DEBOUNCE_EAGER:    presses are reported at once, only releases are filtered,
+                   so chatter after a press cannot end it early [default]
+DEBOUNCE_DEFERRED: presses and releases have to be stable for DEBOUNCE_US,
+                   a glitch shorter than that is never reported (Sampler)
+*/
+#define DEBOUNCE_EAGER		0
+#define DEBOUNCE_DEFERRED	1
+
+#ifndef DEBOUNCE_MODE
+#define DEBOUNCE_MODE DEBOUNCE_EAGER
+#endif
+
+#ifndef DEBOUNCE_US
+#define DEBOUNCE_US 4000
+#endif
+
+typedef struct {
+	uint16_t state;	/* debounced, 1 == pressed */
+	uint16_t cnt0;
+	uint16_t cnt1;
+} debounce_t;
+
+void debounceStep(debounce_t *d, uint16_t sample) {
+	uint16_t delta, toggle;
+
+	delta = sample ^ d->state;
+#if (DEBOUNCE_MODE == DEBOUNCE_EAGER)
+	d->state |= delta & sample;
+	delta &= ~sample;
+#endif
+
+	toggle = delta & d->cnt0 & d->cnt1;
+	d->state ^= toggle;
+	delta &= ~toggle;
+
+	d->cnt1 = (d->cnt1 ^ d->cnt0) & delta;
+	d->cnt0 = ~d->cnt0 & delta;
+}
+
+/*
+Sampler
+=======
+Timer2 interrupts SAMPLE_HZ times per second, independent of the host's
+polls. Every interrupt advances autofireTicks, reads the pins, ORs the
+pressed buttons into the press latch and publishes a sample; every
+DEBOUNCE_STEP-th one also runs the debounce steps. A report only shows what
+was held when it was built, so without the latch a tap between two host
+polls would be lost; each report includes every button pressed since the
+previous one. The latch takes what the debounce reports as pressed: with
+DEBOUNCE_EAGER that is any pin seen pressed, so the pins go in at every
+sample and a press is caught to within a sample period; with
+DEBOUNCE_DEFERRED only the debounced state goes in, so a contact glitch
+reaches neither the report nor autofire. A press new to the latch flags
+inputsChanged like a debounced change.
+
+The interrupt re-enables interrupts first thing, so the USB interrupt is
+held off by the vector jump only. Should the USB interrupt keep it busy past
+the next compare match, the nested run returns at once and that tick is
+lost rather than the debounce state being stepped twice at once.
+
+Handoff
+=======
+Main code never disables interrupts to read the sampler. Each step writes
+its result to the sample slot the main loop is not reading, then bumps
+sampleSeq, so samples[sampleSeq & 1] is always complete. A reader copies
+that slot and checks sampleSeq again: the next step writes the other slot,
+only the one after that could have overwritten the copy, so it retries if
+sampleSeq moved by two or more, which takes a USB interrupt longer than a
+sample period in the middle of a few loads.
+
+The latch is private to the interrupt. takePresses() tells it which sample
+it took; if that is still the latest at the next step, the latch restarts
+from the held buttons, else it keeps accumulating and the taps show up in
+the next report as well, never in none.
+*/
+#ifndef SAMPLE_HZ
+#define SAMPLE_HZ 4000
+#endif
+
+#define SAMPLER_OCR ((F_CPU / 32UL + SAMPLE_HZ / 2) / SAMPLE_HZ - 1)	/* Timer2 at F_CPU/32 */
+#if SAMPLER_OCR > 255
+#error "SAMPLE_HZ too low for Timer2 at this F_CPU"
+#endif
+
+// samples per debounce step, four steps span DEBOUNCE_US
+#define DEBOUNCE_STEP ((DEBOUNCE_US * (SAMPLE_HZ / 100UL) + 20000UL) / 40000UL)
+
+// keeps the compiler from moving memory accesses across it
+#define barrier() __asm__ __volatile__("" ::: "memory")
+
+typedef struct {
+	input_t  in;		/* debounced */
+	uint16_t presses;	/* buttons pressed since the last takePresses() */
+} sample_t;
+
+debounce_t buttonsDebounce;
+debounce_t dirsDebounce;
+sample_t samples[2];
+volatile uint8_t sampleSeq = 0;		/* samples[sampleSeq & 1] is the latest */
+volatile uint8_t pressTaken = 0;	/* set with pressTakenSeq by takePresses() */
+volatile uint8_t pressTakenSeq;
+volatile uint8_t autofireTicks = 0;	/* samples, the autofire timebase */
+volatile uint8_t inputsChanged = 1;	/* debounced state changed, set here, cleared by main */
+
+void samplerInit() {
+#ifdef TCCR2A
+	TCCR2A = (1<<WGM21);				// CTC
+	TCCR2B = (1<<CS21)|(1<<CS20);		// F_CPU/32
+	OCR2A  = SAMPLER_OCR;
+	TIMSK2 |= (1<<OCIE2A);
+#else
+	TCCR2  = (1<<WGM21)|(1<<CS21)|(1<<CS20);
+	OCR2   = SAMPLER_OCR;
+	TIMSK |= (1<<OCIE2);
+#endif
+}
+
+// Reads the pins, steps the debounce if asked to and publishes the next sample slot
+static inline void samplerStep(uint8_t debounce) {
+	static uint16_t pressLatch = 0;
+	sample_t *next = &samples[(uint8_t)(sampleSeq + 1) & 1];
+	input_t in;
+	uint16_t latched, buttons = buttonsDebounce.state;
+	uint8_t dirs = dirsDebounce.state;
+
+	sampleInputs(&in);
+	if(debounce) {
+		debounceStep(&buttonsDebounce, in.buttons);
+		debounceStep(&dirsDebounce, in.dirs);
+		if(buttons != buttonsDebounce.state || dirs != dirsDebounce.state)
+			inputsChanged = 1;
+	}
+
+	if(pressTaken) {
+		pressTaken = 0;
+		if(pressTakenSeq == sampleSeq)
+			pressLatch = 0;		// the latest was taken, nothing is pending
+	}
+	latched = pressLatch | buttonsDebounce.state;
+#if (DEBOUNCE_MODE == DEBOUNCE_EAGER)
+	latched |= in.buttons;		// presses count at once, between steps too
+#endif
+	if(latched & ~(pressLatch | buttons))
+		inputsChanged = 1;	// a press neither latched nor held before
+	pressLatch = latched;
+
+	next->in.buttons = buttonsDebounce.state;
+	next->in.dirs = dirsDebounce.state;
+	next->presses = pressLatch;
+	barrier();
+	sampleSeq++;
+}
+
+ISR(TIMER2_COMP_vect, ISR_NOBLOCK) {
+	static volatile uint8_t busy = 0;
+	uint8_t debounce = 1;
+#if (DEBOUNCE_STEP > 1)
+	static uint8_t step = 0;
+#endif
+
+	if(busy)
+		return;
+	busy = 1;
+	autofireTicks++;
+#if (DEBOUNCE_STEP > 1)
+	debounce = ++step >= DEBOUNCE_STEP;
+	if(debounce)
+		step = 0;
+#endif
+	samplerStep(debounce);
+	busy = 0;
+}
+
+// Copies the latest sample without blocking the sampler, returns its sequence number
+uint8_t readSample(sample_t *s) {
+	uint8_t seq;
+
+	do {
+		seq = sampleSeq;
+		barrier();
+		*s = samples[seq & 1];
+		barrier();
+	} while((uint8_t)(sampleSeq - seq) > 1);
+
+	return seq;
+}
+
+// Copies the debounced input state
+void readInputs(input_t *in) {
+	sample_t s;
+
+	readSample(&s);
+	*in = s.in;
+}
+
+// Copies the debounced input state, returns the buttons pressed since the last call
+uint16_t takePresses(input_t *in) {
+	sample_t s;
+
+	pressTakenSeq = readSample(&s);
+	pressTaken = 1;
+	*in = s.in;
+
+	return s.presses;
+}
+
+/* ------------------------------------------------------------------------- */
+/* ------------------------------ Input core ------------------------------- */
+/* ------------------------------------------------------------------------- */
+
+/*
+SOCD resolution, the report builders for the stick modes and autofire live in
+InputCore.c, which builds into this file the way this file builds into the
+variants. Here they are bound to config.
+*/
+#include "InputCore.c"
+
+// The SOCD mode config field, SOCD_DEFAULT falls back to the variant's policy
+void socdBind() {
+	uint8_t mode = CFG_SOCD_MODE;
+
+	if(mode == SOCD_DEFAULT)
+		mode = SOCD_POLICY;
+	socdSelect(mode);
+}
+
+void reportBind() {
+	reportSelect(config);
+	inputsChanged = 1;	// rebuild for the new stick mode
+}
+
+/* ------------------------------------------------------------------------- */
+/* ------------------------------- Profiling ------------------------------- */
+/* ------------------------------------------------------------------------- */
+
+/*
+Profiling
+=========
+With PROFILE defined Timer1 runs free at F_CPU / PROFILE_PRESCALER and its
+count stamps the main loop's stages:
+PROFILE_USB    usbPoll()
+PROFILE_REPORT ReadJoystick()
+PROFILE_CONFIG configPoll(), which queues the EEPROM writes
+PROFILE_LOOP   one pass of the main loop, from usbPoll() to usbPoll()
+The EE_RDY interrupt is not stamped: it runs with interrupts enabled and
+its statistics could not be read without blocking V-USB.
+
+The feature report gains vendor usage 0x2622 after the 8 bytes of 0x2621:
+min, max and mean of every stage in the order above, then the longest time
+between usbPoll() returning and being called again, all as 16-bit little
+endian timer counts. Reading the report starts a new measurement. Passes
+longer than 65535 counts wrap, use a prescaler of 8 (CS11) to see long
+gaps. usbconfig.h must add PROFILE_DESCRIPTOR_LENGTH to
+USB_CFG_HID_REPORT_DESCRIPTOR_LENGTH in profiling builds.
+*/
+#ifdef PROFILE
+
+#ifndef PROFILE_PRESCALER
+#define PROFILE_PRESCALER	(1<<CS10)	/* Timer1 at F_CPU */
+#endif
+
+#define PROFILE_USB		0
+#define PROFILE_REPORT	1
+#define PROFILE_CONFIG	2
+#define PROFILE_LOOP	3
+#define PROFILE_STAGES	4
+
+#define PROFILE_DESCRIPTOR_LENGTH 7	/* bytes the descriptor grows by */
+
+typedef struct {
+	uint16_t min;
+	uint16_t max;
+	uint32_t sum;
+	uint16_t count;
+} profileStage_t;
+
+typedef struct {
+	struct {
+		uint16_t min;
+		uint16_t max;
+		uint16_t mean;
+	} stage[PROFILE_STAGES];
+	uint16_t usbGap;
+} profileReport_t;
+
+profileStage_t profileStages[PROFILE_STAGES];
+uint16_t profileUsbGap;
+uint16_t profileUsbStart, profileUsbEnd;
+uint16_t profileMark;
+
+void profileReset() {
+	uint8_t i;
+
+	memset(profileStages, 0, sizeof(profileStages));
+	for(i = 0; i < PROFILE_STAGES; i++)
+		profileStages[i].min = 0xffff;
+	profileUsbGap = 0;
+}
+
+void profileInit() {
+	TCCR1A = 0;
+	TCCR1B = PROFILE_PRESCALER;
+	profileReset();
+}
+
+void profileAdd(uint8_t stage, uint16_t counts) {
+	profileStage_t *p = &profileStages[stage];
+
+	if(counts < p->min)
+		p->min = counts;
+	if(counts > p->max)
+		p->max = counts;
+	if(p->count == 0xffff) {
+		// halve both, the mean stays
+		p->sum >>= 1;
+		p->count >>= 1;
+	}
+	p->sum += counts;
+	p->count++;
+}
+
+// usbPoll() with its own time, the time since the last pass and the gap
+void profileUsbPoll() {
+	uint16_t start = TCNT1;
+
+	if((uint16_t)(start - profileUsbEnd) > profileUsbGap)
+		profileUsbGap = start - profileUsbEnd;
+	profileAdd(PROFILE_LOOP, start - profileUsbStart);
+	profileUsbStart = start;
+	usbPoll();
+	profileUsbEnd = TCNT1;
+	profileAdd(PROFILE_USB, profileUsbEnd - start);
+}
+
+// Fills the feature report, V-USB sends it over several packets
+void profileSnapshot(profileReport_t *r) {
+	uint8_t i;
+
+	for(i = 0; i < PROFILE_STAGES; i++) {
+		profileStage_t *p = &profileStages[i];
+
+		r->stage[i].min = p->count ? p->min : 0;
+		r->stage[i].max = p->max;
+		r->stage[i].mean = p->count ? p->sum / p->count : 0;
+	}
+	r->usbGap = profileUsbGap;
+	profileReset();
+}
+
+#define PROFILE_BEGIN()		profileMark = TCNT1
+#define PROFILE_END(stage)	profileAdd(stage, TCNT1 - profileMark)
+
+#else
+
+#define PROFILE_BEGIN()
+#define PROFILE_END(stage)
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* ----------------------------- USB interface ----------------------------- */
+/* ------------------------------------------------------------------------- */
+
+/* ------------------------------------------------------------------------- */
+
+/*
+Reports are built into one of two buffers while the other holds the report
+last handed to V-USB; queueing one swaps the pointers. GET_REPORT answers
+from a buffer of its own, as V-USB may still read it from usbMsgPtr after
+usbFunctionSetup() has returned.
+*/
+static	report_t reportBuffers[2];
+static	report_t *reportBuffer = &reportBuffers[0];	/* being built */
+static	report_t *reportSent = &reportBuffers[1];	/* last queued */
+
+typedef struct {
+	uint8_t			magic[8];	// usage 0x2621
+#ifdef PROFILE
+	profileReport_t	profile;	// usage 0x2622
+#endif
+} feature_t;
+
+static	feature_t featureBuffer = { {
+	33,	// 0x21  bin 0 0 1 0 .  0 0 0 1
+	38	// 0x26  bin 0 0 1 0 .  0 1 1 0
+} };
+static	uchar	idleRate = 0;	/* HID idle rate in 4 ms units, 0 == only on change */
+
+usbMsgLen_t usbFunctionSetup(uchar data[8])
+{
+	usbRequest_t    *rq = (void *)data;
+
+    if((rq->bmRequestType & USBRQ_TYPE_MASK) == USBRQ_TYPE_CLASS) {    /* class request */
+		/* wValue: ReportType (highbyte), ReportID (lowbyte) */
+        if(rq->bRequest == USBRQ_HID_GET_REPORT) {
+#ifdef PROFILE
+			profileSnapshot(&featureBuffer.profile);
+#endif
+			usbMsgPtr = (void *)&featureBuffer;
+
+			return sizeof(featureBuffer);
+        }
+		else if(rq->bRequest == USBRQ_HID_GET_IDLE) {
+			usbMsgPtr = (void *)&idleRate;
+			return 1;
+		}
+		else if(rq->bRequest == USBRQ_HID_SET_IDLE) {
+			idleRate = rq->wValue.bytes[1];
+		}
+    }
+
+    return 0;   /* default for not implemented requests: return no data back to host */
+}
+
+/*
+The input report part of the descriptor is expanded from REPORT_FIELDS, see
+Report layout in InputCore.h. The axes share their ranges and one main item,
+so their usages are a second pass over the fields. The feature items take
+their size and ranges from the axes; a build without axes sets them itself,
+or the hat's would carry over.
+*/
+#define DESCRIBE_NONE(...)
+#define DESCRIBE_BUTTONS(n) \
+    0x15, 0x00,                    /*   LOGICAL_MINIMUM (0) */ \
+    0x25, 0x01,                    /*   LOGICAL_MAXIMUM (1) */ \
+    0x35, 0x00,                    /*   PHYSICAL_MINIMUM (0) */ \
+    0x45, 0x01,                    /*   PHYSICAL_MAXIMUM (1) */ \
+    0x75, 0x01,                    /*   REPORT_SIZE (1) */ \
+    0x95, (n),                     /*   REPORT_COUNT (n) */ \
+    0x05, 0x09,                    /*   USAGE_PAGE (Button) */ \
+    0x19, 0x01,                    /*   USAGE_MINIMUM (Button 1) */ \
+    0x29, (n),                     /*   USAGE_MAXIMUM (Button n) */ \
+    0x81, 0x02,                    /*   INPUT (Data,Var,Abs) */ \
+    0x95, (-(n) & 7),              /*   REPORT_COUNT (to a whole byte) */ \
+    0x81, 0x01,                    /*   INPUT (Cnst,Ary,Abs) */
+#define DESCRIBE_HAT() \
+    0x05, 0x01,                    /*   USAGE_PAGE (Generic Desktop) */ \
+    0x25, 0x07,                    /*   LOGICAL_MAXIMUM (7) */ \
+    0x46, 0x3b, 0x01,              /*   PHYSICAL_MAXIMUM (315) */ \
+    0x75, 0x04,                    /*   REPORT_SIZE (4) */ \
+    0x95, 0x01,                    /*   REPORT_COUNT (1) */ \
+    0x65, 0x14,                    /*   UNIT (Eng Rot:Angular Pos) */ \
+    0x09, 0x39,                    /*   USAGE (Hat switch) */ \
+    0x81, 0x42,                    /*   INPUT (Data,Var,Abs,Null) */ \
+    0x65, 0x00,                    /*   UNIT (None) */ \
+    0x95, 0x01,                    /*   REPORT_COUNT (1) */ \
+    0x81, 0x01,                    /*   INPUT (Cnst,Ary,Abs) */
+#define DESCRIBE_AXIS(name, usage) \
+    0x09, (usage),                 /*   USAGE (axis) */
+
+const PROGMEM char usbHidReportDescriptor[] = { // PC HID Report Descriptor
+    0x05, 0x01,                    // USAGE_PAGE (Generic Desktop)
+    0x09, 0x05,                    // USAGE (Game Pad)
+    0xa1, 0x01,                    // COLLECTION (Application)
+    REPORT_FIELDS(DESCRIBE_BUTTONS, DESCRIBE_HAT, DESCRIBE_NONE)
+#if REPORT_AXES
+    0x26, 0xff, 0x00,              //   LOGICAL_MAXIMUM (255)
+    0x46, 0xff, 0x00,              //   PHYSICAL_MAXIMUM (255)
+    REPORT_FIELDS(DESCRIBE_NONE, DESCRIBE_NONE, DESCRIBE_AXIS)
+    0x75, 0x08,                    //   REPORT_SIZE (8)
+    0x95, REPORT_AXES,             //   REPORT_COUNT (axes)
+    0x81, 0x02,                    //   INPUT (Data,Var,Abs)
+#else
+    0x75, 0x08,                    //   REPORT_SIZE (8)
+    0x26, 0xff, 0x00,              //   LOGICAL_MAXIMUM (255)
+    0x46, 0xff, 0x00,              //   PHYSICAL_MAXIMUM (255)
+#endif
+    0x06, 0x00, 0xff,              //   USAGE_PAGE (Vendor Defined Page 1)
+    0x0a, 0x21, 0x26,              //   UNKNOWN
+    0x95, 0x08,                    //   REPORT_COUNT (8)
+    0xb1, 0x02,                    //   FEATURE (Data,Var,Abs)
+#ifdef PROFILE
+    0x0a, 0x22, 0x26,              //   UNKNOWN
+    0x95, sizeof(profileReport_t), //   REPORT_COUNT
+    0xb1, 0x02,                    //   FEATURE (Data,Var,Abs)
+#endif
+    0xc0                           // END_COLLECTION
+};
+
+#ifdef USB_CFG_HID_REPORT_DESCRIPTOR_LENGTH
+typedef char descriptorLengthCheck[sizeof(usbHidReportDescriptor) == USB_CFG_HID_REPORT_DESCRIPTOR_LENGTH ? 1 : -1];
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* --------------------------------- Timer --------------------------------- */
+/* ------------------------------------------------------------------------- */
+
+/*
+Timer0 runs free at F_CPU/1024 and its overflow flag is polled from the main
+loop, so no interrupt competes with V-USB. One overflow is a tick:
+12 MHz: 21.8 ms, 16 MHz: 16.4 ms
+*/
+#define TICK_US				(256UL * 1024UL * 1000UL / (F_CPU / 1000UL))
+#define MS_TO_TICKS(ms)		(((ms) * 1000UL + TICK_US - 1) / TICK_US)
+
+uint8_t ticks = 0;
+
+void timerInit() {
+	TCCR0 = (1<<CS02)|(1<<CS00);	// Timer0 at F_CPU/1024
+}
+
+void timerPoll() {
+	if(TIFR & (1<<TOV0)) {
+		TIFR = (1<<TOV0);			// cleared by writing a one
+		ticks++;
+	}
+}
+
+/*
+Time in Timer0 counts of 1024 cycles (12 MHz: 85.3 us, 16 MHz: 64 us),
+wraps after 256 ticks.
+*/
+#define US_TO_COUNTS(us)	((us) * (F_CPU / 1000UL) / 1024000UL)	/* us < 350000 */
+
+uint16_t timerNow() {
+	uint8_t count;
+
+	timerPoll();
+	count = TCNT0;
+	if(TIFR & (1<<TOV0)) {
+		// overflowed after timerPoll(), count may belong to the next tick
+		timerPoll();
+		count = TCNT0;
+	}
+
+	return ((uint16_t)ticks << 8) | count;
+}
+
+/* ------------------------------------------------------------------------- */
+/* ----------------------------- EEPROM writer ----------------------------- */
+/* ------------------------------------------------------------------------- */
+
+/*
+A write job copies up to EEPROM_JOB_MAX bytes to EEPROM in the background.
+The EE_READY interrupt starts one byte at a time and re-arms itself until the
+job is done, so the ~3.4 ms per byte never blocks usbPoll(). Bytes that
+already hold the value are skipped to save EEPROM endurance.
+*/
+#define EEPROM_JOB_MAX 19	/* a profile, see Profiles */
+
+uint8_t eepromJob[EEPROM_JOB_MAX];
+uint8_t *eepromJobAddr;
+uint8_t eepromJobPos;
+volatile uint8_t eepromJobLen = 0; /* bytes left, 0 == idle */
+
+#define EEPROM_BUSY (eepromJobLen != 0)
+
+void eepromWriteAsync(void *dst, const void *src, uint8_t len) {
+	uint8_t i;
+
+	for(i = 0; i < len; i++)
+		eepromJob[i] = ((const uint8_t *)src)[i];
+
+	eepromJobAddr = dst;
+	eepromJobPos = 0;
+	eepromJobLen = len;
+	EECR |= (1<<EERIE);
+}
+
+// EE_READY proper, called from the vector with interrupts enabled
+void eepromWorker(void) __attribute__((used, noinline));
+void eepromWorker(void) {
+	uint8_t data;
+
+	while(eepromJobLen) {
+		data = eepromJob[eepromJobPos++];
+		EEAR = (uint16_t)eepromJobAddr++;
+		EECR |= (1<<EERE);
+		eepromJobLen--;
+
+		if(EEDR != data) {
+			EEDR = data;
+			cli(); // EEWE has to follow EEMWE within four cycles
+			EECR |= (1<<EEMWE);
+			EECR |= (1<<EEWE);
+			if(eepromJobLen)
+				EECR |= (1<<EERIE); // fires again when this byte is written
+			return;
+		}
+	}
+}
+
+/*
+EE_READY is level triggered, so it has to be masked before interrupts are
+enabled again, and a compiler prologue would hold the USB interrupt off
+while it saves registers. The vector masks it and re-enables interrupts
+first thing, then saves what a call may clobber and calls the worker.
+*/
+ISR(EE_RDY_vect, ISR_NAKED) {
+	__asm__ __volatile__(
+		"cbi %[eecr], %[eerie]"		"\n\t"
+		"sei"						"\n\t"
+		"push r0"					"\n\t"
+		"in r0, __SREG__"			"\n\t"
+		"push r0"					"\n\t"
+		"push r1"					"\n\t"
+		"clr r1"					"\n\t"
+		"push r18"					"\n\t"
+		"push r19"					"\n\t"
+		"push r20"					"\n\t"
+		"push r21"					"\n\t"
+		"push r22"					"\n\t"
+		"push r23"					"\n\t"
+		"push r24"					"\n\t"
+		"push r25"					"\n\t"
+		"push r26"					"\n\t"
+		"push r27"					"\n\t"
+		"push r30"					"\n\t"
+		"push r31"					"\n\t"
+		"%~call eepromWorker"		"\n\t"
+		"pop r31"					"\n\t"
+		"pop r30"					"\n\t"
+		"pop r27"					"\n\t"
+		"pop r26"					"\n\t"
+		"pop r25"					"\n\t"
+		"pop r24"					"\n\t"
+		"pop r23"					"\n\t"
+		"pop r22"					"\n\t"
+		"pop r21"					"\n\t"
+		"pop r20"					"\n\t"
+		"pop r19"					"\n\t"
+		"pop r18"					"\n\t"
+		"pop r1"					"\n\t"
+		"pop r0"					"\n\t"
+		"out __SREG__, r0"			"\n\t"
+		"pop r0"					"\n\t"
+		"reti"
+		:: [eecr] "I" (_SFR_IO_ADDR(EECR)), [eerie] "I" (EERIE));
+}
+
+/* ------------------------------------------------------------------------- */
+/* ------------------------------ Config store ----------------------------- */
+/* ------------------------------------------------------------------------- */
+
+/*
+config is kept in a ring of CONFIG_RING_SLOTS records in EEPROM. Every save
+goes to the slot after the newest record with the next sequence number, which
+spreads the writes over all slots. Sequence numbers of neighbouring slots
+count up by one, so the newest record is the last slot before that run
+breaks and configLoad() finds it with a single pass over the sequence bytes.
+The sequence byte is written last and covered by the check byte, so a record
+torn by a power loss is skipped and the one before it is used.
+*/
+#define CONFIG_RING_SLOTS 32	/* < 128 so the sequence run stays unique */
+
+typedef struct {
+	uint8_t config;
+	uint8_t profile;	/* active profile, see Profiles */
+	uint8_t check;
+	uint8_t seq;
+} configRecord_t;
+
+#define CONFIG_CHECK(rec) ((uint8_t)~((rec).config + (rec).profile + (rec).seq))
+
+configRecord_t configRing[CONFIG_RING_SLOTS] EEMEM;
+
+uint8_t configSlot = CONFIG_RING_SLOTS - 1;	/* slot of the newest record */
+uint8_t profileActive = 0;					/* see Profiles */
+uint8_t configSeq = 0xFF;					/* its sequence number */
+
+/*
+Returns the config of the newest valid record. Without one the legacy
+config_EEPROM byte is returned, which is EEPROM_DEF on a blank EEPROM.
+*/
+uint8_t configLoad() {
+	configRecord_t rec;
+	uint8_t i, n, seq, next;
+
+	seq = eeprom_read_byte(&configRing[0].seq);
+	for(i = 0; i < CONFIG_RING_SLOTS - 1; i++) {
+		next = eeprom_read_byte(&configRing[i + 1].seq);
+		if(next != (uint8_t)(seq + 1))
+			break;
+		seq = next;
+	}
+
+	for(n = 0; n < CONFIG_RING_SLOTS; n++) {
+		eeprom_read_block(&rec, &configRing[i], sizeof(rec));
+		if(rec.check == CONFIG_CHECK(rec)) {
+			configSlot = i;
+			configSeq = rec.seq;
+			profileActive = rec.profile;
+			return rec.config;
+		}
+		i = i ? i - 1 : CONFIG_RING_SLOTS - 1;
+	}
+
+	return eeprom_read_byte(&config_EEPROM);
+}
+
+/* Queues config as a new record, the caller makes sure EEPROM is idle */
+void configSave() {
+	configRecord_t rec;
+
+	if(++configSlot == CONFIG_RING_SLOTS)
+		configSlot = 0;
+
+	rec.config = config;
+	rec.profile = profileActive;
+	rec.seq = ++configSeq;
+	rec.check = CONFIG_CHECK(rec);
+	eepromWriteAsync(&configRing[configSlot], &rec, sizeof(rec));
+}
+
+/*
+The mode setters only change config in RAM. configPoll() persists it once it
+has been stable for CONFIG_SETTLE_MS and differs from what is stored, so
+holding Home+direction neither stalls USB nor wears the EEPROM.
+*/
+#define CONFIG_SETTLE_MS 1000
+
+uint8_t configStored;	/* config as stored or being stored in EEPROM */
+uint8_t configSeen;		/* config at the last configPoll() */
+uint8_t profileStored;	/* the same for the active profile */
+uint8_t profileSeen;
+uint8_t configChangedAt;
+
+/*
+Profiles
+========
+A profile is a complete setup: config (stick mode, Home emulation, SOCD),
+the button remap and the autofire settings. PROFILES of them live in EEPROM
+and are all read into profiles[] at plug-in, so switching by holding the
+action button + Select for half a second is a few RAM copies and takes
+effect with the next report. The config store keeps the active profile's
+number next to config.
+
+The active profile follows config and autofire where they change:
+chordPoll() tracks it after every chord action, profilePoll() after an
+autofire press, which buildReport() flags in autofireChanged. profilePoll()
+writes a profile back through the EEPROM writer once it has been stable
+for CONFIG_SETTLE_MS, so like config it never blocks the main loop. A blank
+or torn profile starts out as a copy of the config at plug-in with the
+buttons as wired and autofire off.
+
+Remap teach mode: plug in with the action button and Select held, release
+everything, then press the buttons in the order they should be sent as
+report buttons 1, 2, 3... Pressing the action button ends it early; the
+buttons not pressed take the remaining report buttons in their own order,
+so ending it at once restores the default layout. The map goes to the
+active profile and is written before USB is connected.
+*/
+#define PROFILES 4
+
+typedef struct {
+	uint8_t  config;
+	uint8_t  map[REMAP_BUTTONS];	/* see Button remap in InputCore.c */
+	uint8_t  autofire[4];			/* see autofireSave(), as bytes for EEPROM */
+	uint8_t  check;
+} profile_t;
+
+typedef char profileFitsEepromJob[sizeof(profile_t) <= EEPROM_JOB_MAX ? 1 : -1];
+
+profile_t profiles_EEPROM[PROFILES] EEMEM;
+profile_t profiles[PROFILES];
+uint8_t profileDirty = 0;		/* bit per profile to be written */
+uint8_t profileChangedAt;
+
+uint8_t profileCheck(const profile_t *p) {
+	const uint8_t *b = (const uint8_t *)p;
+	uint8_t i, sum = 0;
+
+	for(i = 0; i < offsetof(profile_t, check); i++)
+		sum += b[i];
+	return ~sum;
+}
+
+// Reads all profiles, blocking, before USB is connected
+void profilesLoad(uint8_t cfg) {
+	profile_t *p;
+	uint8_t i, n;
+
+	eeprom_read_block(profiles, profiles_EEPROM, sizeof(profiles));
+	if(profileActive >= PROFILES)
+		profileActive = 0;
+	for(n = 0, p = profiles; n < PROFILES; n++, p++) {
+		if(p->check != profileCheck(p)) {
+			p->config = cfg;
+			for(i = 0; i < REMAP_BUTTONS; i++)
+				p->map[i] = i;
+			memset(p->autofire, 0, sizeof(p->autofire));
+		}
+	}
+}
+
+// Makes profile n active, config has to be bound by the caller
+void profileSelect(uint8_t n) {
+	uint32_t autofire;
+
+	profileActive = n;
+	config = profiles[n].config;
+	remapSelect(profiles[n].map);
+	memcpy(&autofire, profiles[n].autofire, sizeof(autofire));
+	autofireLoad(autofire);
+}
+
+// Copies config and autofire into the active profile
+void profileTrack() {
+	profile_t *p = &profiles[profileActive];
+	uint32_t autofire = autofireSave();
+
+	autofireChanged = 0;
+
+	if(p->config != config || memcmp(p->autofire, &autofire, sizeof(autofire))) {
+		p->config = config;
+		memcpy(p->autofire, &autofire, sizeof(autofire));
+		profileDirty |= 1 << profileActive;
+		profileChangedAt = ticks;
+	}
+}
+
+// Next profile, the current one keeps its settings for switching back,
+// autofire pressed since the last profilePoll() included
+void profileNext() {
+	profileTrack();
+	profileSelect(profileActive + 1 < PROFILES ? profileActive + 1 : 0);
+	socdBind();
+	reportBind();
+}
+
+void profilePoll() {
+	profile_t *p;
+	uint8_t n;
+
+	if(autofireChanged)
+		profileTrack();
+
+	if(profileDirty && !EEPROM_BUSY
+			&& (uint8_t)(ticks - profileChangedAt) >= MS_TO_TICKS(CONFIG_SETTLE_MS)) {
+		for(n = 0, p = profiles; !(profileDirty & (1 << n)); n++, p++)
+			;
+		profileDirty &= ~(1 << n);
+		p->check = profileCheck(p);
+		eepromWriteAsync(&profiles_EEPROM[n], p, sizeof(profile_t));
+	}
+}
+
+// Samples the pins every 10 ms, the sampler is not running yet
+uint16_t remapTeachSample() {
+	input_t in;
+
+	_delay_ms(10);
+	sampleInputs(&in);
+	return in.buttons;
+}
+
+void remapTeach() {
+	profile_t *p = &profiles[profileActive];
+	uint16_t assigned = 0, last, held, pressed;
+	uint8_t i, next = 0;
+
+	while(remapTeachSample())
+		;
+	last = 0;
+	while(next < REMAP_BUTTONS) {
+		held = remapTeachSample();
+		pressed = held & ~last;	// a bounce repeats an assigned button only
+		last = held;
+		if(pressed & DEFAULT_ACTION_BUTTON)
+			break;
+		pressed &= BTN_REPORT_MASK & ~assigned;
+		for(i = 0; i < REMAP_BUTTONS; i++) {
+			if(pressed & (1 << i)) {
+				p->map[i] = next++;
+				assigned |= 1 << i;
+				break;
+			}
+		}
+	}
+
+	for(i = 0; i < REMAP_BUTTONS; i++)
+		if(!(assigned & (1 << i)))
+			p->map[i] = next++;
+	p->check = profileCheck(p);
+	eeprom_update_block(p, &profiles_EEPROM[profileActive], sizeof(profile_t));
+}
+
+/*
+Macros
+======
+A macro is a recorded run of the inputs the reports were built from, each
+with the number of host polls since the one before, so playing it back
+gives the host the same reports at the same polls.
+
+Hold the action button + Select + Start for a second to record: recording
+starts once everything is released and keeps the last MACRO_EVENTS
+changes in an SRAM ring. The same chord stops it, drops the chord's own
+presses from the end and writes the macro to EEPROM in the background, a
+chunk per configPoll(). Hold the action button + Start for half a second
+to play it, again to stop early.
+
+While a macro records or plays a report is queued for every poll, so
+ReadJoystick() runs once per poll and sees polls of 0 or 1; a change built
+but never taken replaces the last event instead of adding one, so playback
+applies at most one event per report. Idle, a macro costs a test of
+macroState in ReadJoystick() and reportDue().
+*/
+#ifndef MACRO_EVENTS
+#define MACRO_EVENTS 32
+#endif
+
+#define MACRO_IDLE		0
+#define MACRO_ARMED		1	/* records once everything is released */
+#define MACRO_RECORDING	2
+#define MACRO_PLAYING	3
+
+#define MACRO_CHORD	(DEFAULT_ACTION_BUTTON|BTN_SELECT|BTN_START)
+#define MACRO_SAVED	0xff	/* macroSaveAt when nothing is left to write */
+
+typedef struct {
+	uint8_t  polls;		/* host polls since the previous event */
+	uint8_t  dirs;
+	uint16_t buttons;
+} macroEvent_t;
+
+typedef char macroFitsSaveOffset[MACRO_EVENTS * sizeof(macroEvent_t) < MACRO_SAVED ? 1 : -1];
+
+typedef struct {
+	uint8_t count;
+	uint8_t check;		/* of count and the events, written last */
+} macroHeader_t;
+
+macroEvent_t macroEvents_EEPROM[MACRO_EVENTS] EEMEM;
+macroHeader_t macroHeader_EEPROM EEMEM;
+
+macroEvent_t macroEvents[MACRO_EVENTS];
+uint8_t macroState = MACRO_IDLE;
+uint8_t macroCount = 0;				/* events */
+uint8_t macroHead;					/* recording: next slot, playing: next event */
+uint8_t macroPolls;					/* since the last event */
+input_t macroInput;					/* of the last event */
+uint8_t macroSaveAt = MACRO_SAVED;	/* bytes of macroEvents written */
+
+uint8_t macroCheck() {
+	const uint8_t *b = (const uint8_t *)macroEvents;
+	uint8_t i, sum = macroCount;
+
+	for(i = 0; i < macroCount * sizeof(macroEvent_t); i++)
+		sum += b[i];
+	return ~sum;
+}
+
+// Reads the macro, blocking, before USB is connected
+void macroLoad() {
+	macroHeader_t h;
+
+	eeprom_read_block(&h, &macroHeader_EEPROM, sizeof(h));
+	macroCount = h.count <= MACRO_EVENTS ? h.count : 0;
+	eeprom_read_block(macroEvents, macroEvents_EEPROM, macroCount * sizeof(macroEvent_t));
+	if(h.check != macroCheck())
+		macroCount = 0;
+}
+
+void macroAppend(uint8_t polls, const input_t *in) {
+	macroEvent_t *e = &macroEvents[macroHead];
+
+	e->polls = polls;
+	e->dirs = in->dirs;
+	e->buttons = in->buttons;
+	if(++macroHead == MACRO_EVENTS)
+		macroHead = 0;
+	if(macroCount < MACRO_EVENTS)
+		macroCount++;
+}
+
+void macroReverse(uint8_t from, uint8_t to) {
+	macroEvent_t e;
+
+	while(from + 1 < to) {
+		e = macroEvents[from];
+		macroEvents[from++] = macroEvents[--to];
+		macroEvents[to] = e;
+	}
+}
+
+// The chord to record or stop recording
+void macroRecordToggle() {
+	macroEvent_t *e;
+
+	if(macroState == MACRO_IDLE && macroSaveAt == MACRO_SAVED) {
+		macroState = MACRO_ARMED;
+		return;
+	}
+	if(macroState == MACRO_ARMED) {
+		macroState = MACRO_IDLE;	// nothing recorded, the old macro stays
+		return;
+	}
+	if(macroState != MACRO_RECORDING)
+		return;
+
+	// oldest event first, a ring that wrapped is rotated by macroHead
+	if(macroCount == MACRO_EVENTS && macroHead) {
+		macroReverse(0, macroHead);
+		macroReverse(macroHead, MACRO_EVENTS);
+		macroReverse(0, MACRO_EVENTS);
+	}
+	macroEvents[0].polls = 0;	// played with the first report
+	for(e = &macroEvents[macroCount - 1]; macroCount; macroCount--, e--)
+		if(e->dirs || !e->buttons || (e->buttons & ~MACRO_CHORD))
+			break;
+	macroState = MACRO_IDLE;
+	macroSaveAt = 0;
+}
+
+// The chord to play the macro or stop playing
+void macroPlayToggle() {
+	if(macroState == MACRO_PLAYING)
+		macroState = MACRO_IDLE;
+	else if(macroState == MACRO_IDLE && macroCount) {
+		macroHead = 0;
+		macroState = MACRO_PLAYING;
+	}
+}
+
+/*
+Called by ReadJoystick() with the input of the report and the polls since
+the last one while macroState is not MACRO_IDLE: records the input, or
+replaces it with the macro's.
+*/
+void macroStep(input_t *in, uint8_t polls) {
+	uint16_t elapsed = macroPolls + polls;
+	macroEvent_t *e;
+
+	if(macroState == MACRO_PLAYING) {
+		// the first event goes out with the first report
+		macroPolls = !macroHead ? 0 : elapsed > 0xff ? 0xff : elapsed;
+		if(macroHead == macroCount) {
+			if(macroPolls) {
+				macroState = MACRO_IDLE;	// the last event had its poll
+				return;
+			}
+		}
+		else {
+			e = &macroEvents[macroHead];
+			if(macroPolls >= e->polls) {
+				macroPolls -= e->polls;
+				macroInput.buttons = e->buttons;
+				macroInput.dirs = e->dirs;
+				macroHead++;
+			}
+		}
+		*in = macroInput;
+		return;
+	}
+
+	if(macroState == MACRO_ARMED) {
+		if(in->buttons || in->dirs)
+			return;
+		macroState = MACRO_RECORDING;
+		macroCount = macroHead = macroPolls = 0;
+		macroInput = *in;
+		macroAppend(0, in);
+		return;
+	}
+
+	if(elapsed > 0xff) {
+		// too long for one event, the input so far is repeated
+		macroAppend(0xff, &macroInput);
+		elapsed -= 0xff;
+	}
+	macroPolls = elapsed;
+	if(in->buttons == macroInput.buttons && in->dirs == macroInput.dirs)
+		return;
+	macroInput = *in;
+	if(!macroPolls) {
+		// the host never took the last event's report
+		e = &macroEvents[macroHead ? macroHead - 1 : MACRO_EVENTS - 1];
+		e->dirs = in->dirs;
+		e->buttons = in->buttons;
+	}
+	else
+		macroAppend(macroPolls, in);
+	macroPolls = 0;
+}
+
+// Writes the next chunk of a recorded macro, the count and check go last
+void macroPoll() {
+	macroHeader_t h;
+	uint8_t left;
+
+	if(macroSaveAt == MACRO_SAVED || EEPROM_BUSY)
+		return;
+	left = macroCount * sizeof(macroEvent_t) - macroSaveAt;
+	if(left) {
+		if(left > EEPROM_JOB_MAX)
+			left = EEPROM_JOB_MAX;
+		eepromWriteAsync((uint8_t *)macroEvents_EEPROM + macroSaveAt,
+						 (uint8_t *)macroEvents + macroSaveAt, left);
+		macroSaveAt += left;
+	}
+	else {
+		h.count = macroCount;
+		h.check = macroCheck();
+		eepromWriteAsync(&macroHeader_EEPROM, &h, sizeof(h));
+		macroSaveAt = MACRO_SAVED;
+	}
+}
+
+void configPoll() {
+	if(config != configSeen || profileActive != profileSeen) {
+		configSeen = config;
+		profileSeen = profileActive;
+		configChangedAt = ticks;
+	}
+
+	if((config != configStored || profileActive != profileStored) && !EEPROM_BUSY
+			&& (uint8_t)(ticks - configChangedAt) >= MS_TO_TICKS(CONFIG_SETTLE_MS)) {
+		configStored = config;
+		profileStored = profileActive;
+		configSave();
+	}
+	profilePoll();
+	macroPoll();
+}
+
+void configInit() {
+	uint8_t newConfig;
+	input_t in;
+
+	config = configLoad(); /* read config from EEPROM */
+
+	if(config == EEPROM_DEF)
+		/* if EEPROM is unitialized set to default config */
+        newConfig = CONFIG_DEF;
+	else
+		newConfig = config;
+
+	/*if(!Stick_Select) {
+		// enter configuration modification mode 
+		usbDeviceDisconnect(); // prevents unsuccessful initialization by host 
+
+		while(Stick_Start) {
+			if(!Stick_Up) {
+				// Dual Strike digital pad: enabled
+				newConfig |= (1<<2);
+				// Dual Strike left stick: disabled
+				newConfig &= ~(1<<1);
+				// Dual Strike right stick: disabled
+				newConfig &= ~(1<<3);
+			}
+			else if(!Stick_Left) {
+				// Dual Strike digital pad: disabled
+				newConfig &= ~(1<<2);
+				// Dual Strike left stick: enabled
+				newConfig |= (1<<1);
+				// Dual Strike right stick: disabled
+				newConfig &= ~(1<<3);
+			}
+			else if(!Stick_Right) {
+				// Dual Strike digital pad: disabled
+				newConfig &= ~(1<<2);
+				// Dual Strike left stick: disabled
+				newConfig &= ~(1<<1);
+				// Dual Strike right stick: enabled
+				newConfig |= (1<<3);
+			}
+			
+			if(!Stick_Down)
+				// Dual Strike digital pad: enabled
+				newConfig |= (1<<2);
+
+			if(!Stick_Short) {
+				if(!Stick_Left)
+					// default working mode: Dual Strike
+					newConfig &= ~(1<<0);
+				
+				if(!Stick_Right)
+					// default working mode: pass-through
+					newConfig |= (1<<0);
+			}
+			
+			if(!Stick_Forward) {
+				// revert to defaults
+				newConfig = CONFIG_DEF;
+			}
+			
+			if(!Stick_Jab) {
+				if(!Stick_Left)
+					// Start+Select=Home: disabled
+					newConfig &= ~(1<<4);
+				
+				if(!Stick_Right)
+					// Start+Select=Home: enabled
+					newConfig |= (1<<4);
+			}
+		}
+	}*/
+
+	sampleInputs(&in);
+	if(in.buttons & DEFAULT_ACTION_BUTTON) {
+		// SOCD mode, see SOCD Mode
+		if(in.buttons & BTN_SQUARE)
+			newConfig = (newConfig & ~CFG_SOCD_MASK) | (SOCD_DEFAULT<<CFG_SOCD_SHIFT);
+		else if(in.buttons & BTN_CROSS)
+			newConfig = (newConfig & ~CFG_SOCD_MASK) | (SOCD_NEUTRAL<<CFG_SOCD_SHIFT);
+		else if(in.buttons & BTN_CIRCLE)
+			newConfig = (newConfig & ~CFG_SOCD_MASK) | (SOCD_UP_PRIORITY<<CFG_SOCD_SHIFT);
+		else if(in.buttons & BTN_TRIANGLE)
+			newConfig = (newConfig & ~CFG_SOCD_MASK) | (SOCD_LAST_INPUT<<CFG_SOCD_SHIFT);
+	}
+
+	if(newConfig != config) {
+		// if newConfig was changed update configuration,
+		// written as soon as interrupts are enabled
+		config = newConfig;
+		configSave();
+	}
+
+	profilesLoad(config);
+	profiles[profileActive].config = config;
+	if((in.buttons & (DEFAULT_ACTION_BUTTON|BTN_SELECT)) == (DEFAULT_ACTION_BUTTON|BTN_SELECT))
+		remapTeach();
+	profileSelect(profileActive);
+	macroLoad();
+
+	configStored = configSeen = config;
+	profileStored = profileSeen = profileActive;
+	socdBind();
+	reportBind();
+}
+
+/*
+void setModeDS() {
+	if(CFG_JOYSTICK_SWITCH_READ) {		
+		PORTD |= (1<<4); // pin S3 is high
+		PORTC |= (1<<6); // pin S4 is high
+	}
+
+	SwitchMode = 0;
+}
+
+void setModePT() {	
+	if(CFG_HOME_EMU)
+		DDRC |= (1<<5);	// make the home an output
+
+	if(CFG_JOYSTICK_SWITCH_READ) {	
+		PORTD |= (1<<4); // pin S3 is high
+		PORTC |= (1<<6); // pin S4 is high
+	}
+	else if(CFG_JOYSTICK_SWITCH_EMU || CFG_INVERTED_TRIGGERS) {
+		DDRD |= (1<<4); // pin S3 is output
+		DDRC |= (1<<6); // pin S4 is output
+	}
+
+	PORTD &= ~(1<<0); // disable ps3 usb
+	PORTD |= (1<<3); // enable pass-through usb
+
+	SwitchMode = 1;
+}
+*/
+/*
+Startup Behaviour
+=================
+If a button or joystick direction is pressed, when the Dual Strike controller
+is activated (if the machine it is plugged in is turned on or the controller gets
+plugged into the machine), then special functions are activated:
+
+If the Select button is pressed, then configuration mode is entered (see below).
+
+If the Start button is pressed, then firmware update mode is entered (see below).
+
+If any other Button except Home is pressed, then the non default working mode is entered.
+The working mode is either the Dual Strike acting as a controller (default) or pass-through (e.g.
+a XBox360 controller PCB).
+
+If the joystick is moved to the up direction, the joystick is acting as a digital pad
+when in Dual Strike working mode (default).
+If the joystick is moved to the left direction, the joystick is acting as a left analogue
+stick when in Dual Strike working mode.
+If the joystick is moved to the right direction, the joystick is acting as a right analogue
+stick when in Dual Strike working mode.
+*/
+void HardwareInit() {
+	DDRC	= 0b00000000;	// PINC inputs
+	PORTC	= 0b00111111;	// PORTC with pull-ups Rst PC6
+
+	DDRB	= 0b00000000;	// PINB inputs
+	PORTB	= 0b00111111;	// PORTB with pull-ups except clock
+	
+
+	DDRD	= 0b00000000;  // PIND inputs
+	PORTD	= ~((1<<USB_CFG_DMINUS_BIT)|(1<<USB_CFG_DPLUS_BIT));   // PORTD with pull-ups except D+ and D-
+
+	configInit();
+	timerInit();
+	samplerInit();
+#ifdef PROFILE
+	profileInit();
+#endif
+
+	/*if(!Stick_Up) // [precedence]
+	{
+		// Dual Strike digital pad: enabled
+		config |= (1<<2);
+		// Dual Strike left stick: disabled
+		config &= ~(1<<1);
+		// Dual Strike right stick: disabled
+		config &= ~(1<<3);
+	}
+	else if(!Stick_Left) {
+		// Dual Strike digital pad: disabled
+		config &= ~(1<<2);
+		// Dual Strike left stick: enabled
+		config |= (1<<1);
+		// Dual Strike right stick: disabled
+		config &= ~(1<<3);
+	}
+	else if(!Stick_Right) {
+		// Dual Strike digital pad: disabled
+		config &= ~(1<<2);
+		// Dual Strike left stick: disabled
+		config &= ~(1<<1);
+		// Dual Strike right stick: enabled
+		config |= (1<<3);
+	}
+	
+	if (   (!Stick_Jab)
+		|| (!Stick_Strong) 
+		|| (!Stick_Fierce)
+		|| (!Stick_Short)
+		|| (!Stick_Forward)
+#ifdef EXTRA_BUTTONS
+		|| (!Stick_Extra0)
+#endif
+		) {
+		// if any punch or kick is held down, then set to non-default mode
+		if(CFG_DEF_WORK_MODE_DS)
+			setModePT();
+		else
+			setModeDS();
+	}
+	else {
+		// else set to default mode
+		if(CFG_DEF_WORK_MODE_DS)
+			setModeDS();
+		else
+			setModePT();
+	}*/
+}
+
+/* ------------------------------------------------------------------------- */
+
+uint8_t  autofireLast = 0;	/* autofireTicks at the last report */
+uint8_t  hostPolls = 0;		/* reports taken by the host */
+uint8_t  autofireLastPoll = 0;	/* hostPolls at the last report */
+uint16_t reportPresses = 0;	/* latched presses in the queued report */
+
+void ReadJoystick() {  // Called once at each 16 ms or 22ms
+	input_t in;
+	uint8_t elapsed, polls;
+
+	// taps since the last report, kept if the queued report is rebuilt
+	reportPresses |= takePresses(&in);
+	in.buttons |= reportPresses;
+
+	elapsed = autofireTicks - autofireLast;
+	autofireLast += elapsed;
+	polls = hostPolls - autofireLastPoll;
+	autofireLastPoll = hostPolls;
+
+	if(macroState)
+		macroStep(&in, polls);
+	buildReport(reportBuffer, &in, elapsed, polls);
+}
+
+/* ------------------------------------------------------------------------- */
+/* --------------------------- Report scheduling --------------------------- */
+/* ------------------------------------------------------------------------- */
+
+/*
+Reports are queued only when they differ from the last one sent, or when the
+idle period set by the host with SET_IDLE has run out (never with the default
+idle rate of 0). Meanwhile V-USB NAKs the host's polls by itself.
+
+The report is not even rebuilt unless something can have changed it: the
+sampler flags every change of the debounced inputs in inputsChanged, so a
+change is still queued within one sample and goes out on the next poll.
+Otherwise only a report taken by the host (frame locked autofire counts
+polls), a held button with timed autofire, or the idle period running out
+call for a new one, and the loop goes straight back to usbPoll(). The
+ATmega8 has no pin change interrupts; the sampler sees every pin anyway and
+reports debounced changes only, so contacts bouncing cannot cause rebuilds.
+Frame locked autofire needs every poll, so it is sent unconditionally while
+such a button is held.
+*/
+// Timer0 counts of an idle rate in 4 ms units, rounded once for the whole period
+#define IDLE_COUNTS(rate)	(((rate) * 4UL * (F_CPU / 1000UL) + 512UL) / 1024UL)
+
+uint16_t reportSentAt;			/* timerNow() when it was queued */
+
+// Nonzero once the idle period since the last report has run out
+uint8_t reportIdleDue() {
+	return idleRate && (uint16_t)(timerNow() - reportSentAt) >= IDLE_COUNTS(idleRate);
+}
+
+// Nonzero if reportBuffer should be queued
+uint8_t reportDue() {
+	return reportEveryPoll || macroState || memcmp(reportBuffer, reportSent, sizeof(report_t))
+		|| reportIdleDue();
+}
+
+// Hands reportBuffer to V-USB and swaps buffers
+void reportQueue() {
+	report_t *queued = reportBuffer;
+
+	usbSetInterrupt((void *)queued, sizeof(report_t));
+	reportBuffer = reportSent;
+	reportSent = queued;
+	reportSentAt = timerNow();
+}
+
+/*
+By default a report is built as soon as the host has taken the previous one
+and then waits a whole polling interval in the V-USB buffer. With JIT_REPORTS
+defined the main loop also tracks the host's polls and, JIT_LEAD before the
+next one is due, samples again and refreshes the queued report if it
+changed. The host then sees inputs at most about JIT_LEAD old. Polls are
+timed in USB frames when V-USB counts them (USB_COUNT_SOF), otherwise in
+1/16 Timer0 counts, so that whole counts lost per period do not add up.
+
+Only the polls that take a report are seen; the host's NAKed polls in
+between are predicted by stepping the last one by whole periods on every
+pass of the main loop, so a report queued after a quiet spell is refreshed
+just before the poll that takes it, not at once. The period starts out as
+AUTOFIRE_POLL_MS, the interval hosts poll at (see Autofire), and follows
+the gaps between taken reports: a gap of about k periods, k up to
+JIT_GAP_POLLS, is a sample of gap / k, averaged over the last few.
+*/
+#ifdef JIT_REPORTS
+
+#if USB_COUNT_SOF
+typedef uint8_t jitTime_t;
+#define JIT_NOW()	usbSofCount
+#define JIT_MS(ms)	(ms)									/* frames */
+#define JIT_WRAP	0x100UL
+#else
+typedef uint16_t jitTime_t;
+#define JIT_NOW()	((jitTime_t)(timerNow() << 4))
+#define JIT_MS(ms)	((ms) * (F_CPU / 1000UL) * 16 / 1024UL)	/* 1/16 Timer0 counts */
+#define JIT_WRAP	0x10000UL
+#endif
+#define JIT_LEAD		((jitTime_t)JIT_MS(1))
+#define JIT_GAP_POLLS	8
+
+// a gap of JIT_GAP_POLLS polls has to be timed without wrapping
+typedef char jitGapFits[(JIT_GAP_POLLS + 1) * JIT_MS(AUTOFIRE_POLL_MS) < JIT_WRAP ? 1 : -1];
+
+jitTime_t jitTakenAt;		/* when the host last took a report */
+jitTime_t jitLastPoll;		/* ...or the last poll predicted since */
+jitTime_t jitPeriod = (jitTime_t)JIT_MS(AUTOFIRE_POLL_MS);
+uint8_t jitPolls = JIT_GAP_POLLS;	/* polls predicted since jitTakenAt */
+uint8_t jitRefreshed = 1;
+
+// Called on every pass of the main loop, steps over the polls the host NAKed
+void jitTrack() {
+	if((jitTime_t)(JIT_NOW() - jitLastPoll) >= jitPeriod) {
+		jitLastPoll += jitPeriod;
+		if(jitPolls < JIT_GAP_POLLS)
+			jitPolls++;
+		// a refresh only makes sense if there is time left before the next poll
+		jitRefreshed = (jitPeriod <= 2 * JIT_LEAD);
+	}
+}
+
+// Called right after the host has taken a report
+void jitPolled() {
+	jitTime_t now = JIT_NOW(), gap = now - jitTakenAt;
+	uint8_t k;
+
+	// jitPolls tells a gap that wrapped from a short one
+	if(jitPolls < JIT_GAP_POLLS) {
+		k = (gap + jitPeriod / 2) / jitPeriod;
+		if(k)
+			jitPeriod += ((int16_t)(gap / k) - (int16_t)jitPeriod) / 4;
+	}
+	jitTakenAt = jitLastPoll = now;
+	jitPolls = 0;
+	jitRefreshed = (jitPeriod <= 2 * JIT_LEAD);
+}
+
+// Nonzero once the queued report should be refreshed
+uint8_t jitDue() {
+	return !jitRefreshed && (jitTime_t)(JIT_NOW() - jitLastPoll) >= (jitTime_t)(jitPeriod - JIT_LEAD);
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+void enterLeftStickMode() {
+    // Dual Strike digital pad: disabled
+    config &= ~(1<<2);
+    // Dual Strike left stick: enabled
+    config |= (1<<1);
+    // Dual Strike right stick: disabled
+    config &= ~(1<<3);
+}
+
+void enterRightStickMode() {
+	// Dual Strike digital pad: disabled
+	config &= ~(1<<2);
+	// Dual Strike left stick: disabled
+	config &= ~(1<<1);
+	// Dual Strike right stick: enabled
+	config |= (1<<3);
+}
+
+void enterDigitalPadMode() {
+    // Dual Strike digital pad: enabled
+    config |= (1<<2);
+    // Dual Strike left stick: disabled
+    config &= ~(1<<1);
+    // Dual Strike right stick: disabled
+    config &= ~(1<<3);
+}
+
+void enterLeftStickDigitalPadMode() {
+    // Dual Strike digital pad: enabled
+    config |= (1<<2);
+    // Dual Strike left stick: enabled
+    config |= (1<<1);
+    // Dual Strike right stick: disabled
+    config &= ~(1<<3);
+}
+
+/* ------------------------------------------------------------------------- */
+/* --------------------------------- Chords -------------------------------- */
+/* ------------------------------------------------------------------------- */
+
+/*
+Chords
+======
+Hotkeys are rows of chords[]: a chord matches when the buttons and
+directions under its masks equal its patterns, and its action runs once
+when it has matched for hold Timer0 counts; it has to be let go before it
+can fire again. chordPoll() compares the input with the table only when
+the input changes, otherwise it just checks the hold times of matched
+chords that have not fired yet, so a new hotkey is one more row and adds
+nothing to the report path. After an action config is bound again.
+
+Home emulation stays with the report builders: it rewrites the report as
+long as Start+Select are held rather than doing something once.
+*/
+typedef struct {
+	uint16_t	buttonsMask;
+	uint16_t	buttons;
+	uint8_t		dirsMask;
+	uint8_t		dirs;
+	uint16_t	hold;		/* Timer0 counts */
+	void		(*action)(void);
+} chord_t;
+
+#define CHORD_DIRS	(DIR_UP|DIR_DOWN|DIR_LEFT|DIR_RIGHT)
+#define HOLD_MS(ms)	((ms) * (F_CPU / 1024UL) / 1000UL)
+
+#define HOLD_PROFILE_MS	500
+#define HOLD_PLAY_MS	500
+#define HOLD_RECORD_MS	1000
+
+// timerNow() wraps at 16 bits: 5.5 s at 12 MHz, 4.1 s at 16 MHz
+typedef char chordHoldProfileFits[HOLD_MS(HOLD_PROFILE_MS) <= 0xffff ? 1 : -1];
+typedef char chordHoldPlayFits[HOLD_MS(HOLD_PLAY_MS) <= 0xffff ? 1 : -1];
+typedef char chordHoldRecordFits[HOLD_MS(HOLD_RECORD_MS) <= 0xffff ? 1 : -1];
+
+// action button + one direction selects the stick mode
+#define MODE_CHORD(dir, setter) \
+	{ DEFAULT_ACTION_BUTTON, DEFAULT_ACTION_BUTTON, CHORD_DIRS, (dir), 0, (setter) }
+
+const chord_t chords[] PROGMEM = {
+	MODE_CHORD(DIR_UP,		enterDigitalPadMode),
+	MODE_CHORD(DIR_LEFT,	enterLeftStickMode),
+	MODE_CHORD(DIR_RIGHT,	enterRightStickMode),
+	MODE_CHORD(DIR_DOWN,	enterLeftStickDigitalPadMode),
+	// action button + Select held for half a second: next profile, see Profiles
+	{ MACRO_CHORD, DEFAULT_ACTION_BUTTON|BTN_SELECT, 0, 0, HOLD_MS(HOLD_PROFILE_MS), profileNext },
+	// action button + Start held for half a second: play a macro, see Macros
+	{ MACRO_CHORD, DEFAULT_ACTION_BUTTON|BTN_START, 0, 0, HOLD_MS(HOLD_PLAY_MS), macroPlayToggle },
+	// action button + Select + Start held for a second: record a macro
+	{ MACRO_CHORD, MACRO_CHORD, 0, 0, HOLD_MS(HOLD_RECORD_MS), macroRecordToggle },
+#ifdef CLEAR_AUTOFIRE
+	// Start+Select: autofire off on all buttons
+	{ MACRO_CHORD, BTN_START|BTN_SELECT, 0, 0, 0, autofireClear },
+#endif
+};
+
+#define CHORDS (sizeof(chords) / sizeof(chords[0]))
+
+// chordMatched and chordFired have a bit per chord
+typedef char chordsFitMask[CHORDS <= 16 ? 1 : -1];
+
+input_t  chordInput;			/* input at the last chordPoll() */
+uint16_t chordMatched = 0;		/* bit per chord */
+uint16_t chordFired = 0;
+uint16_t chordSince[CHORDS];	/* timerNow() when it started to match */
+
+void chordPoll(const input_t *in) {
+	chord_t c;
+	uint16_t now = timerNow(), bit;
+	uint8_t i;
+
+	if(in->buttons != chordInput.buttons || in->dirs != chordInput.dirs) {
+		chordInput = *in;
+		for(i = 0, bit = 1; i < CHORDS; i++, bit <<= 1) {
+			memcpy_P(&c, &chords[i], sizeof(c));
+			if((in->buttons & c.buttonsMask) == c.buttons && (in->dirs & c.dirsMask) == c.dirs) {
+				if(!(chordMatched & bit)) {
+					chordMatched |= bit;
+					chordSince[i] = now;
+				}
+			}
+			else {
+				chordMatched &= ~bit;
+				chordFired &= ~bit;
+			}
+		}
+	}
+
+	if(!(chordMatched & ~chordFired))
+		return;
+	for(i = 0, bit = 1; i < CHORDS; i++, bit <<= 1) {
+		if(!(chordMatched & ~chordFired & bit))
+			continue;
+		memcpy_P(&c, &chords[i], sizeof(c));
+		if((uint16_t)(now - chordSince[i]) >= c.hold) {
+			chordFired |= bit;
+			c.action();
+			reportBind();
+			profileTrack();
+		}
+	}
+}
+
+int main(void)
+{
+	input_t in;
+	uint8_t reportQueued = 0;		/* a report is waiting in V-USB */
+	uint8_t reportBackToBack = 0;	/* ...queued as soon as the last was taken */
+
+	HardwareInit();
+
+	 // if switched to Dual Strike
+	    usbDeviceDisconnect(); /* enforce re-enumeration, do this while interrupts are disabled! */
+	    _delay_ms(300UL);/* fake USB disconnect for > 250 ms */
+	    usbDeviceConnect();
+		usbInit();
+	    sei();
+
+	    while(1) { /* main event loop */
+#ifdef PROFILE
+	        profileUsbPoll();
+#else
+	        usbPoll();
+#endif
+	        timerPoll();
+#ifdef JIT_REPORTS
+	        jitTrack();
+#endif
+
+	        readInputs(&in);
+	        chordPoll(&in);
+
+	        PROFILE_BEGIN();
+	        configPoll();
+	        PROFILE_END(PROFILE_CONFIG);
+
+	        if(usbInterruptIsReady()) {
+	            /* called after every poll of the interrupt endpoint */				
+/*				if(CFG_JOYSTICK_SWITCH_READ) {
+					if(!(PIND & (1<<4)) && (PINC & (1<<6))) { // S3 low and S4 high
+						// Dual Strike digital pad: disabled
+						config &= ~(1<<2);
+						// Dual Strike left stick: enabled
+						config |= (1<<1);
+						// Dual Strike right stick: disabled
+						config &= ~(1<<3);
+					}
+					else if((PIND & (1<<4)) && !(PINC & (1<<6))) { // S3 high and S4 low
+						// Dual Strike digital pad: disabled
+						config &= ~(1<<2);
+						// Dual Strike left stick: disabled
+						config &= ~(1<<1);
+						// Dual Strike right stick: enabled
+						config |= (1<<3);
+					}
+					else if((PIND & (1<<4)) && (PINC & (1<<6))) { // S3 high and S4 high
+						// Dual Strike digital pad: enabled
+						config |= (1<<2);
+						// Dual Strike left stick: disabled
+						config &= ~(1<<1);
+						// Dual Strike right stick: disabled
+						config &= ~(1<<3);
+					}
+					else if(!(PIND & (1<<4)) && !(PINC & (1<<6))) { // S3 low and S4 low
+						// Dual Strike digital pad: disabled
+						config &= ~(1<<2);
+						// Dual Strike left stick: disabled
+						config &= ~(1<<1);
+						// Dual Strike right stick: disabled
+						config &= ~(1<<3);
+					}
+				}
+*/
+
+				if(reportQueued) {
+					// the host has taken the queued report
+#ifdef JIT_REPORTS
+					jitPolled();
+#endif
+					hostPolls++;
+					reportPresses = 0;
+					reportQueued = 0;
+					reportBackToBack = 1;
+				}
+				if(!reportBackToBack && !inputsChanged && !reportEverySample && !reportIdleDue())
+					continue;	// nothing can have changed the report
+				inputsChanged = 0;
+				PROFILE_BEGIN();
+				ReadJoystick();
+				PROFILE_END(PROFILE_REPORT);
+				if(reportDue()) {
+					reportQueue();
+					reportQueued = 1;
+				}
+				else
+					reportBackToBack = 0;
+	        }
+#ifdef JIT_REPORTS
+	        else if(jitDue()) {
+				jitRefreshed = 1;
+				PROFILE_BEGIN();
+				ReadJoystick();
+				PROFILE_END(PROFILE_REPORT);
+				if(memcmp(reportSent, reportBuffer, sizeof(report_t)))
+					// V-USB NAKs while the buffer is rewritten, so only if needed
+					reportQueue();
+			}
+#endif
+	    }
+
+
+    return 0;
+}
@@ -0,0 +1,488 @@
+/*
+Input core, see InputCore.h. Hardware free: only PROGMEM reads, which are
+plain loads off the AVR.
+*/
+#include <string.h>
+
+#include "InputCore.h"
+
+#ifndef pgm_read_ptr
+#ifdef __AVR__
+#define pgm_read_ptr(p)		((void *)pgm_read_word(p))
+#else
+#define pgm_read_ptr(p)		(*(p))
+#endif
+#endif
+
+#ifndef SAMPLE_HZ
+#define SAMPLE_HZ 4000	/* rate elapsed is counted in, set by the firmware */
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* ---------------------------- SOCD resolution ---------------------------- */
+/* ------------------------------------------------------------------------- */
+
+/*
+Simultaneous opposing cardinal directions are resolved per axis. An axis is a
+2-bit pair of the direction nibble (bit 0: Up/Left, bit 1: Down/Right) with a
+4-bit state:
+
+  bits 0-1: pair resolved last frame
+  bits 2-3: raw pair sampled last frame
+
+The packed SOCD state byte holds the vertical state in the low nibble and the
+horizontal state in the high nibble. A policy is one PROGMEM table per axis
+mapping (state<<2 | raw pair) straight to the next state, so a frame costs two
+table loads no matter what is pressed, and policies differ only in tables:
+
+SOCD_NEUTRAL:     Up+Down and Left+Right resolve to neutral
+SOCD_UP_PRIORITY: Up wins over Down, Left+Right resolves to neutral
+SOCD_LAST_INPUT:  the direction pressed last wins on both axes,
+                  pressing both in the same frame resolves to neutral
+
+socdSelect() binds a policy to the tables and starts from neutral; the
+firmware picks the policy from its config.
+*/
+
+#define PAIR_NEG	1	/* Up or Left */
+#define PAIR_POS	2	/* Down or Right */
+#define PAIR_BOTH	3
+
+// next axis state for raw pair n resolved to r
+#define SOCD_NEXT(n, r)		(((n)<<2) | (r))
+// directions of raw pair n that were not held in axis state s
+#define SOCD_NEW(s, n)		((n) & ~((s)>>2))
+
+#define SOCD_RULE_NEUTRAL(s, n)		SOCD_NEXT(n, (n) == PAIR_BOTH ? 0 : (n))
+#define SOCD_RULE_NEG_PRIORITY(s, n)	SOCD_NEXT(n, (n) == PAIR_BOTH ? PAIR_NEG : (n))
+#define SOCD_RULE_LAST_INPUT(s, n)	SOCD_NEXT(n, (n) != PAIR_BOTH ? (n) : \
+						SOCD_NEW(s, n) == PAIR_BOTH ? 0 : \
+						SOCD_NEW(s, n) ? SOCD_NEW(s, n) : ((s) & PAIR_BOTH))
+
+#define SOCD_ROW(rule, s)	rule(s, 0), rule(s, 1), rule(s, 2), rule(s, 3)
+#define SOCD_TABLE(rule)	{ \
+	SOCD_ROW(rule,  0), SOCD_ROW(rule,  1), SOCD_ROW(rule,  2), SOCD_ROW(rule,  3), \
+	SOCD_ROW(rule,  4), SOCD_ROW(rule,  5), SOCD_ROW(rule,  6), SOCD_ROW(rule,  7), \
+	SOCD_ROW(rule,  8), SOCD_ROW(rule,  9), SOCD_ROW(rule, 10), SOCD_ROW(rule, 11), \
+	SOCD_ROW(rule, 12), SOCD_ROW(rule, 13), SOCD_ROW(rule, 14), SOCD_ROW(rule, 15) }
+
+const PROGMEM uint8_t socdNeutral[64]     = SOCD_TABLE(SOCD_RULE_NEUTRAL);
+const PROGMEM uint8_t socdNegPriority[64] = SOCD_TABLE(SOCD_RULE_NEG_PRIORITY);
+const PROGMEM uint8_t socdLastInput[64]   = SOCD_TABLE(SOCD_RULE_LAST_INPUT);
+
+const uint8_t *socdVertical = socdNeutral;
+const uint8_t *socdHorizontal = socdNeutral;
+uint8_t socdState = 0;
+
+void socdSelect(uint8_t policy) {
+	switch(policy) {
+	case SOCD_UP_PRIORITY:
+		socdVertical = socdNegPriority;
+		socdHorizontal = socdNeutral;
+		break;
+	case SOCD_LAST_INPUT:
+		socdVertical = socdLastInput;
+		socdHorizontal = socdLastInput;
+		break;
+	default:
+		socdVertical = socdNeutral;
+		socdHorizontal = socdNeutral;
+		break;
+	}
+
+	socdState = 0;
+}
+
+/*
+Resolves the raw direction nibble of a snapshot and returns the resolved
+nibble, which never holds two opposing directions.
+*/
+uint8_t resolveDirections(uint8_t dirs) {
+	uint8_t v, h;
+
+	v = pgm_read_byte(&socdVertical[((socdState & 0x0f) << 2) | (dirs & PAIR_BOTH)]);
+	h = pgm_read_byte(&socdHorizontal[((socdState & 0xf0) >> 2) | (dirs >> 2)]);
+	socdState = (h << 4) | v;
+
+	return ((h & PAIR_BOTH) << 2) | (v & PAIR_BOTH);
+}
+
+// Report values for a resolved direction nibble, see direction_t
+const PROGMEM direction_t directionTable[16] = {
+	/* hat,  x,    y            R L D U */
+	{ 0x08, 0x80, 0x80 },	/* 0 0 0 0  centered   */
+	{ 0x00, 0x80, 0x00 },	/* 0 0 0 1  up         */
+	{ 0x04, 0x80, 0xFF },	/* 0 0 1 0  down       */
+	{ 0x08, 0x80, 0x80 },	/* 0 0 1 1  -          */
+	{ 0x06, 0x00, 0x80 },	/* 0 1 0 0  left       */
+	{ 0x07, 0x00, 0x00 },	/* 0 1 0 1  up-left    */
+	{ 0x05, 0x00, 0xFF },	/* 0 1 1 0  down-left  */
+	{ 0x08, 0x80, 0x80 },	/* 0 1 1 1  -          */
+	{ 0x02, 0xFF, 0x80 },	/* 1 0 0 0  right      */
+	{ 0x01, 0xFF, 0x00 },	/* 1 0 0 1  up-right   */
+	{ 0x03, 0xFF, 0xFF },	/* 1 0 1 0  down-right */
+	{ 0x08, 0x80, 0x80 },	/* 1 0 1 1  -          */
+	{ 0x08, 0x80, 0x80 },	/* 1 1 0 0  -          */
+	{ 0x08, 0x80, 0x80 },	/* 1 1 0 1  -          */
+	{ 0x08, 0x80, 0x80 },	/* 1 1 1 0  -          */
+	{ 0x08, 0x80, 0x80 }	/* 1 1 1 1  -          */
+};
+
+/* ------------------------------------------------------------------------- */
+/* ---------------------------- Report builders ---------------------------- */
+/* ------------------------------------------------------------------------- */
+
+#define RESET_BUTTONS(n)
+#define RESET_HAT()				report->hatswitch = 0x08;
+#define RESET_AXIS(name, usage)	report->name = 0x80;
+
+// Buttons are written whole by buildReport()
+void resetReport(report_t *report) {
+	REPORT_FIELDS(RESET_BUTTONS, RESET_HAT, RESET_AXIS)
+}
+
+/*
+Report builders
+===============
+The stick mode and Home emulation bits of config only change with the
+Home + direction chords, so instead of testing them on every report a
+builder specialized for the configuration writes the directions into the
+report and returns its buttons. reportSelect() picks the builder from
+reportBuilders[], indexed by config bits 1-4, whenever config changes.
+Combinations the chords cannot produce (right stick together with the left
+stick or digital pad) use a builder that still tests the bits at run time.
+A stick mode whose axes the build does not report (see Report layout in
+InputCore.h) falls back to the left stick, then to the digital pad.
+*/
+typedef uint16_t (*reportBuilder_t)(report_t *report, const direction_t *direction, uint16_t buttons);
+
+uint8_t reportConfig;	/* config of the last reportSelect() */
+
+#if REPORT_AXES >= 2
+#define REPORT_LEFT_STICK() \
+		report->x = pgm_read_byte(&direction->x); \
+		report->y = pgm_read_byte(&direction->y);
+#else
+#define REPORT_LEFT_STICK()
+#endif
+
+#if REPORT_AXES >= 4
+#define REPORT_RIGHT_STICK() \
+		report->z  = pgm_read_byte(&direction->x); \
+		report->rz = pgm_read_byte(&direction->y);
+#else
+#define REPORT_RIGHT_STICK()
+#endif
+
+#define REPORT_BUILDER(name, cfg) \
+uint16_t name(report_t *report, const direction_t *direction, uint16_t buttons) { \
+	uint16_t buttonsNow = buttons & BTN_REPORT_MASK; \
+	if((cfg) & (1<<1)) {	/* left stick */ \
+		REPORT_LEFT_STICK() \
+	} \
+	if((cfg) & (1<<3)) {	/* right stick */ \
+		REPORT_RIGHT_STICK() \
+	} \
+	if((cfg) & (1<<2))		/* digital pad */ \
+		report->hatswitch = pgm_read_byte(&direction->hatswitch); \
+	if(((cfg) & (1<<4))		/* Home emulation */ \
+	   && (buttons & (BTN_START|BTN_SELECT)) == (BTN_START|BTN_SELECT)) \
+		buttonsNow = (buttonsNow & ~(BTN_START|BTN_SELECT)) | BTN_HOME; \
+	return buttonsNow; \
+}
+
+REPORT_BUILDER(reportNone,				0)
+REPORT_BUILDER(reportLeft,				(1<<1))
+REPORT_BUILDER(reportPad,				(1<<2))
+REPORT_BUILDER(reportLeftPad,			(1<<1)|(1<<2))
+REPORT_BUILDER(reportRight,				(1<<3))
+REPORT_BUILDER(reportNoneHome,			(1<<4))
+REPORT_BUILDER(reportLeftHome,			(1<<4)|(1<<1))
+REPORT_BUILDER(reportPadHome,			(1<<4)|(1<<2))
+REPORT_BUILDER(reportLeftPadHome,		(1<<4)|(1<<1)|(1<<2))
+REPORT_BUILDER(reportRightHome,			(1<<4)|(1<<3))
+REPORT_BUILDER(reportAny,				reportConfig)
+
+// index bits: Home emulation, right stick, digital pad, left stick
+const reportBuilder_t reportBuilders[16] PROGMEM = {
+	reportNone, reportLeft, reportPad, reportLeftPad,	/* 0 0 x x */
+	reportRight, reportAny, reportAny, reportAny,		/* 0 1 x x */
+	reportNoneHome, reportLeftHome, reportPadHome, reportLeftPadHome,	/* 1 0 x x */
+	reportRightHome, reportAny, reportAny, reportAny	/* 1 1 x x */
+};
+
+reportBuilder_t reportBuilder = reportAny;
+
+void reportSelect(uint8_t cfg) {
+#if REPORT_AXES < 4
+	if(cfg & (1<<3))
+		cfg = (cfg & ~(1<<3)) | (1<<1);
+#endif
+#if REPORT_AXES < 2
+	if(cfg & (1<<1))
+		cfg = (cfg & ~(1<<1)) | (1<<2);
+#endif
+	reportConfig = cfg;
+	reportBuilder = (reportBuilder_t)pgm_read_ptr(&reportBuilders[(cfg >> 1) & 0x0f]);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ------------------------------- Autofire -------------------------------- */
+/* ------------------------------------------------------------------------- */
+
+/*
+Autofire
+========
+Pressing a button while the action button is held cycles its autofire:
+off -> AUTOFIRE_FREQ -> MODE_PRESS_FREQ -> frame locked -> off
+
+Every button has its own rate and phase. The phase is a 16-bit accumulator
+advanced by rate * 65536 / SAMPLE_HZ per sample, so rates are exact
+in Hz whatever F_CPU or the host's polling interval. The button is reported
+in the first half of each period and forced to zero in the second; a press
+restarts the phase, so the first shot goes out at once.
+
+Frame locked autofire counts host polls instead: the button is on for
+AUTOFIRE_ON_POLLS reports and off for AUTOFIRE_OFF_POLLS reports. Pulses
+cannot beat against the host's polling, so with both counts covering a
+60 Hz game frame every pulse is seen by the game and the rate is the
+highest it can tell apart. The counts default to the fewest polls that
+cover a frame at AUTOFIRE_POLL_MS: hosts poll a low-speed endpoint at the
+largest power of two milliseconds not over its bInterval, 8 ms for
+V-USB's usual 10, which takes 3 polls where 10 ms would take 2.
+*/
+
+/*The autofire default frequency of operation in Hz*/
+#define AUTOFIRE_FREQ 5
+
+// MODE PRESSED EACH : second autofire rate in Hz
+#define MODE_PRESS_FREQ 10 
+
+// host polling interval in ms, 8 when built without usbconfig.h
+#ifndef AUTOFIRE_POLL_MS
+#ifdef USB_CFG_INTR_POLL_INTERVAL
+#define AUTOFIRE_POLL_MS \
+	(USB_CFG_INTR_POLL_INTERVAL >= 128 ? 128 : USB_CFG_INTR_POLL_INTERVAL >= 64 ? 64 : \
+	 USB_CFG_INTR_POLL_INTERVAL >= 32 ? 32 : USB_CFG_INTR_POLL_INTERVAL >= 16 ? 16 : \
+	 USB_CFG_INTR_POLL_INTERVAL >= 8 ? 8 : USB_CFG_INTR_POLL_INTERVAL >= 4 ? 4 : \
+	 USB_CFG_INTR_POLL_INTERVAL >= 2 ? 2 : 1)
+#else
+#define AUTOFIRE_POLL_MS 8
+#endif
+#endif
+
+#define AUTOFIRE_FRAME_US 16667UL	/* 60 Hz */
+#define AUTOFIRE_FRAME_POLLS \
+	((uint8_t)((AUTOFIRE_FRAME_US + AUTOFIRE_POLL_MS * 1000UL - 1) / (AUTOFIRE_POLL_MS * 1000UL)))
+
+#ifndef AUTOFIRE_ON_POLLS
+#define AUTOFIRE_ON_POLLS AUTOFIRE_FRAME_POLLS
+#endif
+
+#ifndef AUTOFIRE_OFF_POLLS
+#define AUTOFIRE_OFF_POLLS AUTOFIRE_FRAME_POLLS
+#endif
+
+#define AUTOFIRE_POLLS (AUTOFIRE_ON_POLLS + AUTOFIRE_OFF_POLLS)
+#define AUTOFIRE_LOCKED 0	/* rate of frame locked buttons */
+
+#define AUTOFIRE_BUTTONS 13
+
+#define AUTOFIRE_STEP(hz) ((uint16_t)(((hz) * 65536UL + SAMPLE_HZ / 2) / SAMPLE_HZ))
+
+uint16_t autofireModulator = 0xffff;	/* 1 == autofire off */
+uint8_t  autofireRate[AUTOFIRE_BUTTONS];
+uint16_t autofireStep[AUTOFIRE_BUTTONS];
+uint16_t autofirePhase[AUTOFIRE_BUTTONS];
+uint8_t  reportEveryPoll = 0;	/* a button with frame locked autofire is held */
+uint8_t  reportEverySample = 0;	/* a button with timed autofire is held */
+uint8_t  autofireChanged = 0;	/* a press cycled autofire, cleared by the firmware */
+
+void autofireSetRate(uint8_t button, uint8_t hz) {
+	autofireRate[button] = hz;
+	autofireStep[button] = AUTOFIRE_STEP(hz);
+}
+
+// Turns autofire off on all buttons
+void autofireClear() {
+	autofireModulator = 0xffff;
+}
+
+/*
+The autofire settings of all buttons packed into 2 bits per button, for
+profiles: 0 off, 1 AUTOFIRE_FREQ, 2 MODE_PRESS_FREQ, 3 frame locked.
+*/
+uint32_t autofireSave() {
+	uint32_t packed = 0;
+	uint8_t i, code;
+
+	for(i = AUTOFIRE_BUTTONS; i-- > 0; ) {
+		code = 0;
+		if(!(autofireModulator & (1 << i)))
+			code = autofireRate[i] == AUTOFIRE_FREQ ? 1 :
+				   autofireRate[i] == MODE_PRESS_FREQ ? 2 : 3;
+		packed = (packed << 2) | code;
+	}
+	return packed;
+}
+
+void autofireLoad(uint32_t packed) {
+	static const uint8_t rates[4] = { AUTOFIRE_FREQ, AUTOFIRE_FREQ, MODE_PRESS_FREQ, AUTOFIRE_LOCKED };
+	uint8_t i, code;
+
+	autofireModulator = 0xffff;
+	for(i = 0; i < AUTOFIRE_BUTTONS; i++, packed >>= 2) {
+		code = packed & 0x03;
+		if(code && (AUTOFIRE_MASK & (1 << i)))
+			autofireModulator &= ~(1 << i);
+		autofireSetRate(i, rates[code]);
+		autofirePhase[i] = 0;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* ----------------------------- Button remap ------------------------------ */
+/* ------------------------------------------------------------------------- */
+
+/*
+Button remap
+============
+A remap map gives for every button the report button it is sent as.
+remapSelect() turns it into one table per nibble of the buttons word:
+remapTable[n][v] holds the report bits of the buttons set in v at nibble n,
+so a frame is remapped with four table loads ORed together. Byte tables
+would take 1 KB, all of the ATmega8's SRAM; nibble tables take 128 bytes.
+Autofire and Home emulation work on the buttons as wired, the remap is
+applied to what goes into the report. An identity map turns it off.
+*/
+uint16_t remapTable[4][16];
+uint8_t  remapActive = 0;
+
+// Entries out of range keep the button where it is
+void remapSelect(const uint8_t *map) {
+	uint16_t to;
+	uint8_t i, v;
+
+	memset(remapTable, 0, sizeof(remapTable));
+	remapActive = 0;
+	for(i = 0; i < 16; i++) {
+		to = (uint16_t)1 << i;
+		if(i < REMAP_BUTTONS && map[i] < REMAP_BUTTONS && map[i] != i) {
+			to = (uint16_t)1 << map[i];
+			remapActive = 1;
+		}
+		for(v = 0; v < 16; v++)
+			if(v & (1 << (i & 3)))
+				remapTable[i >> 2][v] |= to;
+	}
+}
+
+static inline uint16_t remapButtons(uint16_t buttons) {
+	return remapTable[0][buttons & 0x0f] | remapTable[1][(buttons >> 4) & 0x0f] |
+		   remapTable[2][(buttons >> 8) & 0x0f] | remapTable[3][buttons >> 12];
+}
+
+/*
+Builds the report for an input snapshot. elapsed is the number of samples
+and polls the number of reports the host took since the last call, they
+advance the autofire phases.
+*/
+void buildReport(report_t *report, const input_t *in, uint8_t elapsed, uint8_t polls) {
+	
+	static uint16_t lastButtons = 0;
+	uint16_t buttonsNow,tempButtons;
+	uint16_t autofireOff, bit;
+	uint8_t i;
+	const direction_t *direction;
+
+	direction = &directionTable[resolveDirections(in->dirs)];
+	
+	
+	resetReport(report);
+
+	// Directions and buttons 1-13 as the stick mode wants them
+	buttonsNow = reportBuilder(report, direction, in->buttons);
+   
+	
+	// Autofire processing
+	
+	// Check for press events on action buttons
+	// butn  -  - 14 13 12 11 10 09 08 07 06 05 04 03 02 01 
+	// bit  15 14 13 12 11 10 09 08 07 06 05 04 03 02 02 00
+	//               Ho R3          R2 L2 R1 L1 /\ () >< []  
+    // mask  0  0  0  1 .1  0  0  0 .1  1  1  1 .1  1  1  1  = 0x18ff 	
+	tempButtons  = buttonsNow & ~lastButtons; // rising bits: 1 rise, 0 not changed
+	tempButtons &= AUTOFIRE_MASK;             // either rising bit corresponds to a press event
+	lastButtons  = buttonsNow;
+
+	autofireOff = 0;
+	reportEveryPoll = 0;
+	reportEverySample = 0;
+	for(i = 0, bit = 1; i < AUTOFIRE_BUTTONS; i++, bit <<= 1) {
+		if(tempButtons & bit) {
+			// Cycle autofire of the button when the action button is held
+			if(in->buttons & DEFAULT_ACTION_BUTTON) {
+				if(autofireModulator & bit) {
+					autofireModulator &= ~bit;
+					autofireSetRate(i, AUTOFIRE_FREQ);
+				}
+				else if(autofireRate[i] == AUTOFIRE_FREQ)
+					autofireSetRate(i, MODE_PRESS_FREQ);
+				else if(autofireRate[i] == MODE_PRESS_FREQ)
+					autofireSetRate(i, AUTOFIRE_LOCKED);
+				else
+					autofireModulator |= bit;
+				autofireChanged = 1;
+			}
+			autofirePhase[i] = 0;
+		}
+		else if(!(autofireModulator & bit)) {
+			if(autofireRate[i] == AUTOFIRE_LOCKED) {
+				// phase counts host polls since the press, only held buttons pulse
+				if(buttonsNow & bit)
+					reportEveryPoll = 1;
+				autofirePhase[i] += polls;
+				while(autofirePhase[i] >= AUTOFIRE_POLLS)
+					autofirePhase[i] -= AUTOFIRE_POLLS;
+				if(autofirePhase[i] >= AUTOFIRE_ON_POLLS)
+					autofireOff |= bit;
+			}
+			else {
+				// only held buttons need their phase kept up every sample
+				if(buttonsNow & bit)
+					reportEverySample = 1;
+				autofirePhase[i] += autofireStep[i] * elapsed;
+				if(autofirePhase[i] & 0x8000)
+					autofireOff |= bit;
+			}
+		}
+	}
+	
+   // 	apply autofire modulation
+	if (!(in->buttons & DEFAULT_ACTION_BUTTON))
+	    buttonsNow &= ~autofireOff;
+	
+   // Autofire modulation works by forcing zero state on action buttons.
+   // if action button is not pressed nothing happens.	
+	
+/*
+4340 dba2      in      a,(0a2h)    nova leitura
+4342 5f        ld      e,a         e = nova leitura buttonsNow                 
+4343 21c4e0    ld      hl,0e0c4h   
+4346 7e        ld      a,(hl)      a = anterior
+4347 73        ld      (hl),e      anterior = nova 
+4348 e60f      and     0fh         temp = anterior & mascara bits
+434a a3        and     e           temp &=nova
+434b ab        xor     e           temp ^=nova
+434c 32c5e0    ld      (0e0c5h),a  rising edges = temp 
+*/	
+		
+	if(remapActive)
+		buttonsNow = remapButtons(buttonsNow);
+
+	// Populate Report
+	report->buttons[0] = (uint8_t) ( buttonsNow     &0xff);
+	report->buttons[1] = (uint8_t) ((buttonsNow>>8) &0xff);
+	
+		
+}
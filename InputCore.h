@@ -0,0 +1,158 @@
+/***
+ *        _                  _       ___ _   _    _   
+ *       /_\  _ _ __ __ _ __| |___  / __| |_(_)__| |__
+ *      / _ \| '_/ _/ _` / _` / -_) \__ \  _| / _| / /
+ *     /_/ \_\_| \__\__,_\__,_\___| |___/\__|_\__|_\_\
+ *                                                    
+ */
+
+/*
+Input core
+==========
+Everything between an input snapshot and a HID report that does not touch
+the hardware: SOCD resolution, stick modes, Home emulation, autofire and
+report packing. ArcadeStick.c includes InputCore.c into its single
+translation unit and feeds it snapshots from the sampler; on a workstation
+InputCore.c builds as an ordinary library (see bench/).
+*/
+#ifndef __InputCore_h_included__
+#define __InputCore_h_included__
+
+#include <stdint.h>
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#endif
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+#ifndef pgm_read_byte
+#define pgm_read_byte(p)	(*(const uint8_t *)(p))
+#endif
+
+/*
+input snapshot description by bits (1 == pressed):
+--------------------------------------------------
+buttons: same layout as the HID report buttons, so it can be masked straight
+         into buttons1/buttons2
+  0: Square    4: L1    8: Select   12: Home
+  1: Cross     5: R1    9: Start    13: Mode (not reported)
+  2: Circle    6: L2   10: L3
+  3: Triangle  7: R2   11: R3
+dirs:    direction nibble
+  0: Up  1: Down  2: Left  3: Right
+*/
+
+#define BTN_SQUARE		(1<<0)
+#define BTN_CROSS		(1<<1)
+#define BTN_CIRCLE		(1<<2)
+#define BTN_TRIANGLE	(1<<3)
+#define BTN_L1			(1<<4)
+#define BTN_R1			(1<<5)
+#define BTN_L2			(1<<6)
+#define BTN_R2			(1<<7)
+#define BTN_SELECT		(1<<8)
+#define BTN_START		(1<<9)
+#define BTN_L3			(1<<10)
+#define BTN_R3			(1<<11)
+#define BTN_HOME		(1<<12)
+#define BTN_MODE		(1<<13)
+
+#define BTN_REPORT_MASK	0x1fff	/* buttons 1-13 of the HID report */
+#define REMAP_BUTTONS	13		/* entries of a remap map, see Button remap */
+
+#define DIR_UP			(1<<0)
+#define DIR_DOWN		(1<<1)
+#define DIR_LEFT		(1<<2)
+#define DIR_RIGHT		(1<<3)
+
+typedef struct {
+	uint16_t buttons;
+	uint8_t  dirs;
+} input_t;
+
+#ifndef DEFAULT_ACTION_BUTTON
+#define DEFAULT_ACTION_BUTTON BTN_MODE	/* holding it toggles autofire */
+#endif
+
+// Buttons autofire can be set on, see Autofire in InputCore.c
+#define AUTOFIRE_MASK (0x18ff & ~DEFAULT_ACTION_BUTTON)
+
+// SOCD policies, see SOCD resolution in InputCore.c
+#define SOCD_DEFAULT		0
+#define SOCD_NEUTRAL		1
+#define SOCD_UP_PRIORITY	2
+#define SOCD_LAST_INPUT		3
+
+/*
+Report values for a resolved direction nibble. The left stick uses x/y, the
+right stick uses the same values as z/rz.
+*/
+typedef struct {
+	uint8_t	hatswitch;
+	uint8_t	x;
+	uint8_t	y;
+} direction_t;
+
+/*
+Report layout
+=============
+REPORT_FIELDS describes the interrupt report in order: BUTTONS(n) is n
+one-bit buttons padded to whole bytes, HAT() a 4-bit hat switch padded to a
+byte and AXIS(name, usage) an 8-bit axis with its Generic Desktop usage.
+report_t here and the HID report descriptor in ArcadeStick.c are both
+expanded from it, so they cannot disagree.
+
+REPORT_AXES picks the axes of a build: 4 = x, y, z, rz [default],
+2 = x, y (no right stick), 0 = none (digital pad only). The report is 7, 5
+or 3 bytes, so a build without axes spends less of every low-speed poll on
+the bus. reportSelect() moves stick modes without axes to the next mode
+the report has. usbconfig.h must set USB_CFG_HID_REPORT_DESCRIPTOR_LENGTH
+to REPORT_DESCRIPTOR_LENGTH for the build's REPORT_AXES.
+*/
+#ifndef REPORT_AXES
+#define REPORT_AXES 4
+#endif
+
+#if REPORT_AXES == 4
+#define REPORT_AXES_LIST(AXIS) \
+	AXIS(x, 0x30) AXIS(y, 0x31) AXIS(z, 0x32) AXIS(rz, 0x35)
+#elif REPORT_AXES == 2
+#define REPORT_AXES_LIST(AXIS)	AXIS(x, 0x30) AXIS(y, 0x31)
+#elif REPORT_AXES == 0
+#define REPORT_AXES_LIST(AXIS)
+#else
+#error "REPORT_AXES must be 0, 2 or 4"
+#endif
+
+#define REPORT_FIELDS(BUTTONS, HAT, AXIS) \
+	BUTTONS(13) HAT() REPORT_AXES_LIST(AXIS)
+
+// bytes of the HID report descriptor, PROFILE adds PROFILE_DESCRIPTOR_LENGTH
+#define REPORT_DESCRIPTOR_LENGTH	(64 + (REPORT_AXES ? 12 + 2 * REPORT_AXES : 8))
+
+#define REPORT_STRUCT_BUTTONS(n)		uint8_t buttons[((n) + 7) / 8];
+#define REPORT_STRUCT_HAT()				uint8_t hatswitch;
+#define REPORT_STRUCT_AXIS(name, usage)	uint8_t name;
+
+typedef struct {
+	REPORT_FIELDS(REPORT_STRUCT_BUTTONS, REPORT_STRUCT_HAT, REPORT_STRUCT_AXIS)
+} report_t;
+
+extern uint8_t socdState;
+extern uint8_t reportConfig;
+extern uint8_t reportEveryPoll;
+extern uint8_t reportEverySample;
+extern uint8_t autofireChanged;
+
+void socdSelect(uint8_t policy);
+uint8_t resolveDirections(uint8_t dirs);
+void reportSelect(uint8_t cfg);
+void autofireSetRate(uint8_t button, uint8_t hz);
+void autofireClear(void);
+uint32_t autofireSave(void);
+void autofireLoad(uint32_t packed);
+void remapSelect(const uint8_t *map);
+void buildReport(report_t *report, const input_t *in, uint8_t elapsed, uint8_t polls);
+
+#endif
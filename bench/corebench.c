@@ -0,0 +1,146 @@
+/*
+Input core micro-benchmark
+==========================
+Drives synthetic input frames through buildReport() of the natively built
+InputCore.c for every SOCD policy, stick mode and autofire setting and
+prints the cost per frame and a checksum of all reports. The inputs come
+from a fixed-seed generator, so the checksums only change when the core's
+behaviour does.
+
+Autofire is set up the way a player would: by pressing every button the
+needed number of times while holding DEFAULT_ACTION_BUTTON.
+
+With -r every frame goes through a button remap that reverses the order of
+the report buttons.
+
+usage: corebench [-n frames] [-s seed] [-r]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "InputCore.h"
+
+#define SAMPLES_PER_FRAME	40	/* 10 ms polls at the firmware's 4 kHz sampler */
+
+static const struct { const char *name; uint8_t policy; } policies[] = {
+	{ "neutral",		SOCD_NEUTRAL },
+	{ "up-priority",	SOCD_UP_PRIORITY },
+	{ "last-input",		SOCD_LAST_INPUT },
+};
+
+/* config bits 1-4 as ArcadeStick.c's mode setters leave them */
+static const struct { const char *name; uint8_t config; } modes[] = {
+	{ "pad",			(1<<2) },
+	{ "left",			(1<<1) },
+	{ "right",			(1<<3) },
+	{ "left+pad",		(1<<1)|(1<<2) },
+	{ "pad+home",		(1<<2)|(1<<4) },
+	{ "right+pad",		(1<<3)|(1<<2) },	/* not settable, generic builder */
+};
+
+/* autofire cycle of a button: off -> 5 Hz -> 10 Hz -> frame locked -> off */
+static const char *autofires[] = { "off", "5Hz", "10Hz", "locked" };
+#define AUTOFIRE_SETTINGS 4
+
+static uint32_t rng;
+static unsigned autofireSetting = 0;
+
+static uint32_t random32(void) {
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+static void frame(report_t *report, uint16_t buttons, uint8_t dirs) {
+	input_t in;
+
+	in.buttons = buttons;
+	in.dirs = dirs;
+	buildReport(report, &in, SAMPLES_PER_FRAME, 1);
+}
+
+// Steps every autofire button through the cycle up to setting
+static void autofireSet(unsigned setting) {
+	report_t report;
+
+	while(autofireSetting != setting) {
+		frame(&report, DEFAULT_ACTION_BUTTON, 0);
+		frame(&report, DEFAULT_ACTION_BUTTON | AUTOFIRE_MASK, 0);
+		frame(&report, DEFAULT_ACTION_BUTTON, 0);
+		autofireSetting = (autofireSetting + 1) % AUTOFIRE_SETTINGS;
+	}
+	frame(&report, 0, 0);
+}
+
+static double seconds(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long frames = 4000000, n;
+	uint32_t seed = 1;
+	unsigned p, m, a;
+	uint8_t map[REMAP_BUTTONS];
+	int opt;
+
+	while((opt = getopt(argc, argv, "n:s:r")) != -1) {
+		switch(opt) {
+		case 'n': frames = strtoul(optarg, NULL, 0); break;
+		case 's': seed = strtoul(optarg, NULL, 0); break;
+		case 'r':
+			for(p = 0; p < REMAP_BUTTONS; p++)
+				map[p] = REMAP_BUTTONS - 1 - p;
+			remapSelect(map);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n frames] [-s seed] [-r]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	printf("%-12s %-10s %-7s %9s  %s\n", "socd", "mode", "autofire", "ns/frame", "checksum");
+	for(p = 0; p < sizeof(policies) / sizeof(policies[0]); p++)
+	for(m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+	for(a = 0; a < AUTOFIRE_SETTINGS; a++) {
+		uint16_t buttons = 0;
+		uint8_t dirs = 0;
+		uint32_t sum = 2166136261u;
+		report_t report;
+		double start;
+
+		autofireSet(a);
+		socdSelect(policies[p].policy);
+		reportSelect(modes[m].config);
+		rng = seed | 1;
+
+		start = seconds();
+		for(n = 0; n < frames; n++) {
+			uint32_t r = random32();
+			const uint8_t *b = (const uint8_t *)&report;
+			unsigned i;
+
+			// about one change every 4 frames, SOCD conflicts included
+			if(!(r & 0x03))
+				buttons ^= (1 << ((r >> 2) % 13)) & ~DEFAULT_ACTION_BUTTON;
+			if(!(r & 0x30))
+				dirs ^= 1 << ((r >> 8) & 0x03);
+
+			frame(&report, buttons, dirs);
+			for(i = 0; i < sizeof(report_t); i++)	// FNV-1a over the report
+				sum = (sum ^ b[i]) * 16777619u;
+		}
+
+		printf("%-12s %-10s %-8s %8.1f  %08x\n", policies[p].name, modes[m].name, autofires[a],
+			   (seconds() - start) * 1e9 / (frames ? frames : 1), sum);
+	}
+
+	return 0;
+}
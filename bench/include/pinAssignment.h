@@ -0,0 +1,25 @@
+/*
+Bench pin assignment
+====================
+A board for the simulator only. All inputs are active low with pull-ups and
+latency.c drives the same pins, keep both in step. PD0 and PD2 are left for
+D- and D+ as on the real boards.
+*/
+#define Stick_Up		(PINB & (1<<2))
+#define Stick_Down		(PINB & (1<<1))
+#define Stick_Left		(PINB & (1<<4))
+#define Stick_Right		(PINB & (1<<3))
+#define Stick_Square	(PINC & (1<<0))
+#define Stick_Cross		(PINC & (1<<1))
+#define Stick_Circle	(PINC & (1<<2))
+#define Stick_Triangle	(PINC & (1<<3))
+#define Stick_R1		(PINC & (1<<4))
+#define Stick_Home		(PINC & (1<<5))
+#define Stick_R2		(PIND & (1<<1))
+#define Stick_Select	(PIND & (1<<3))
+#define Stick_Start		(PIND & (1<<4))
+#define Stick_L3		(PIND & (1<<5))
+#define Stick_L2		(PIND & (1<<6))
+#define Stick_L1		(PIND & (1<<7))
+#define Stick_R3		(PINB & (1<<0))
+#define Stick_Mode		(PINB & (1<<5))
@@ -0,0 +1,17 @@
+/*
+Bench usbconfig.h
+=================
+Just what ArcadeStick.c takes from usbconfig.h; the bench replaces V-USB
+with usbstub.c, so nothing here reaches the bus.
+*/
+#ifndef __usbconfig_h_included__
+#define __usbconfig_h_included__
+
+#define USB_CFG_IOPORTNAME		D
+#define USB_CFG_DMINUS_BIT		0
+#define USB_CFG_DPLUS_BIT		2
+
+#define USB_CFG_INTR_POLL_INTERVAL	10
+#define USB_COUNT_SOF			0
+
+#endif
@@ -0,0 +1,66 @@
+/*
+Bench usbdrv.h
+==============
+Stands in for V-USB under simavr. The interrupt IN endpoint is a mailbox in
+SRAM, benchUsb, that the simulated host (latency.c) reads and clears at
+every poll instead of clocking packets over D+/D-. Control transfers are
+never issued.
+*/
+#ifndef __usbdrv_h_included__
+#define __usbdrv_h_included__
+
+#include <stdint.h>
+#include "usbconfig.h"
+
+typedef unsigned char	uchar;
+typedef uchar			usbMsgLen_t;
+
+typedef union usbWord {
+	unsigned	word;
+	uchar		bytes[2];
+} usbWord_t;
+
+typedef struct usbRequest {
+	uchar		bmRequestType;
+	uchar		bRequest;
+	usbWord_t	wValue;
+	usbWord_t	wIndex;
+	usbWord_t	wLength;
+} usbRequest_t;
+
+#define USBRQ_TYPE_MASK			0x60
+#define USBRQ_TYPE_STANDARD		(0<<5)
+#define USBRQ_TYPE_CLASS		(1<<5)
+#define USBRQ_TYPE_VENDOR		(2<<5)
+
+#define USBRQ_HID_GET_REPORT	0x01
+#define USBRQ_HID_GET_IDLE		0x02
+#define USBRQ_HID_GET_PROTOCOL	0x03
+#define USBRQ_HID_SET_REPORT	0x09
+#define USBRQ_HID_SET_IDLE		0x0a
+#define USBRQ_HID_SET_PROTOCOL	0x0b
+
+/* mailbox states, the host takes a report only in BENCH_QUEUED */
+#define BENCH_IDLE		0
+#define BENCH_WRITING	1
+#define BENCH_QUEUED	2
+
+typedef struct {
+	uchar	state;
+	uchar	len;
+	uchar	data[8];
+} benchUsb_t;
+
+extern volatile benchUsb_t benchUsb;
+extern uchar *usbMsgPtr;
+
+#define usbInterruptIsReady()	(benchUsb.state == BENCH_IDLE)
+#define usbDeviceConnect()
+#define usbDeviceDisconnect()
+
+void usbInit(void);
+void usbPoll(void);
+void usbSetInterrupt(uchar *data, uchar len);
+usbMsgLen_t usbFunctionSetup(uchar data[8]);
+
+#endif
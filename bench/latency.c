@@ -0,0 +1,288 @@
+/*
+Input latency bench
+===================
+Runs a firmware build under simavr and measures how long it takes from a
+pin edge until the host holds a report showing it. The host polls the
+interrupt endpoint every -p microseconds through the benchUsb mailbox of
+usbstub.c: a queued report is taken, otherwise the poll is NAKed and the
+host keeps the report it has.
+
+Inputs are pressed one at a time, round robin over the pins of
+include/pinAssignment.h. A press counts when the host's report first
+differs from the idle report, a release when it is the idle report again.
+Either counts as missed if the host has not seen it after HOLD_MS.
+Edge times, hold times and gaps come from a fixed-seed generator, so runs
+are repeatable and edges land at every phase of the polling interval.
+
+A report rewritten while it is still queued is a JIT_REPORTS refresh; its
+lead is the time from the rewrite to the poll that takes it. With -l the run
+also fails if the 99th percentile lead is over lead_us.
+
+usage: latency [-m mcu] [-f hz] [-p poll_us] [-n events] [-s seed] [-l lead_us]
+               firmware.elf benchUsb_address
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "avr_ioport.h"
+
+typedef struct {
+	const char	*name;
+	char		port;
+	uint8_t		bit;
+} input_t;
+
+/* keep in step with include/pinAssignment.h; L1/L2 need EXTRA_BUTTONS and
+   Mode is not reported, so they are not driven */
+static const input_t inputs[] = {
+	{ "Up",			'B', 2 },
+	{ "Down",		'B', 1 },
+	{ "Left",		'B', 4 },
+	{ "Right",		'B', 3 },
+	{ "Square",		'C', 0 },
+	{ "Cross",		'C', 1 },
+	{ "Circle",		'C', 2 },
+	{ "Triangle",	'C', 3 },
+	{ "R1",			'C', 4 },
+	{ "Home",		'C', 5 },
+	{ "R2",			'D', 1 },
+	{ "Select",		'D', 3 },
+	{ "Start",		'D', 4 },
+	{ "L3",			'D', 5 },
+	{ "R3",			'B', 0 },
+};
+#define INPUTS (sizeof(inputs) / sizeof(inputs[0]))
+
+/* pins pulled up by the firmware, driven high before it starts */
+static const struct { char port; uint8_t mask; } pullUps[] = {
+	{ 'B', 0x3f }, { 'C', 0x3f }, { 'D', 0xfa },
+};
+
+/* mailbox layout, see include/usbdrv.h */
+#define BENCH_IDLE		0
+#define BENCH_WRITING	1
+#define BENCH_QUEUED	2
+#define MAILBOX_STATE	0
+#define MAILBOX_LEN		1
+#define MAILBOX_DATA	2
+#define REPORT_MAX		8
+
+#define BOOT_MS			500		/* past the 300 ms fake disconnect */
+#define SETTLE_MS		100
+#define HOLD_MS			40		/* plus up to HOLD_MS more */
+#define GAP_MS			40		/* plus up to GAP_MS more */
+
+#define EDGE_PRESS		0
+#define EDGE_RELEASE	1
+
+static avr_t *avr;
+static uint16_t mailbox;
+static uint8_t hostReport[REPORT_MAX], idleReport[REPORT_MAX];
+static uint8_t boxState;
+static avr_cycle_count_t refreshAt;		/* last refresh of the queued report, 0 == none */
+static avr_cycle_count_t *leads;
+static int leadCount, leadMax;
+static uint32_t rng;
+
+static uint32_t random32(void) {
+	// xorshift32, the same sequence on every libc
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+static void runUntil(avr_cycle_count_t cycle) {
+	while(avr->cycle < cycle) {
+		int state = avr_run(avr);
+		uint8_t box = avr->data[mailbox + MAILBOX_STATE];
+
+		if(state == cpu_Done || state == cpu_Crashed) {
+			fprintf(stderr, "latency: firmware stopped at cycle %llu\n",
+					(unsigned long long)avr->cycle);
+			exit(1);
+		}
+		// simavr runs one instruction at a time, so no rewrite goes unseen
+		if(boxState == BENCH_QUEUED && box == BENCH_WRITING)
+			refreshAt = avr->cycle;
+		boxState = box;
+	}
+}
+
+static void setPin(char port, uint8_t bit, int level) {
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(port), bit), level);
+}
+
+// One interrupt IN poll, nonzero if a report was taken
+static int hostPoll(void) {
+	uint8_t *box = avr->data + mailbox;
+
+	if(box[MAILBOX_STATE] != BENCH_QUEUED)
+		return 0;	// NAK
+	memset(hostReport, 0, sizeof(hostReport));
+	memcpy(hostReport, box + MAILBOX_DATA,
+		   box[MAILBOX_LEN] < REPORT_MAX ? box[MAILBOX_LEN] : REPORT_MAX);
+	box[MAILBOX_STATE] = BENCH_IDLE;
+	if(refreshAt) {
+		if(leadCount == leadMax) {
+			leadMax = leadMax ? 2 * leadMax : 256;
+			leads = realloc(leads, leadMax * sizeof(*leads));
+		}
+		leads[leadCount++] = avr->cycle - refreshAt;
+		refreshAt = 0;
+	}
+	return 1;
+}
+
+static int compareCycles(const void *a, const void *b) {
+	avr_cycle_count_t x = *(const avr_cycle_count_t *)a;
+	avr_cycle_count_t y = *(const avr_cycle_count_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+// Prints and returns the 99th percentile in us
+static double summary(const char *what, avr_cycle_count_t *v, int n, int missed) {
+	double us = 1e6 / avr->frequency;
+
+	if(!n) {
+		printf("%-8s n=0 missed=%d\n", what, missed);
+		return 0;
+	}
+	qsort(v, n, sizeof(*v), compareCycles);
+	printf("%-8s n=%d missed=%d  min %8.1f  p50 %8.1f  p99 %8.1f  max %8.1f us\n",
+		   what, n, missed,
+		   v[0] * us, v[(n - 1) * 50 / 100] * us, v[(n - 1) * 99 / 100] * us, v[n - 1] * us);
+	return v[(n - 1) * 99 / 100] * us;
+}
+
+int main(int argc, char *argv[]) {
+	const char *mmcu = "atmega8";
+	uint32_t frequency = 12000000;
+	unsigned pollUs = 10000, events = 200, leadUs = 0;
+	elf_firmware_t firmware;
+	avr_cycle_count_t ms, poll, nextPoll, edgeAt = 0, pending = 0;
+	avr_cycle_count_t *latency[2];
+	int count[2] = { 0, 0 }, missed[2] = { 0, 0 };
+	double lead = 0;
+	int edgeType = EDGE_PRESS, waiting = 0;
+	unsigned i, edge;
+	int opt;
+
+	rng = 1;
+	while((opt = getopt(argc, argv, "m:f:p:n:s:l:")) != -1) {
+		switch(opt) {
+		case 'm': mmcu = optarg; break;
+		case 'f': frequency = strtoul(optarg, NULL, 0); break;
+		case 'p': pollUs = strtoul(optarg, NULL, 0); break;
+		case 'n': events = strtoul(optarg, NULL, 0); break;
+		case 's': rng = strtoul(optarg, NULL, 0) | 1; break;
+		case 'l': leadUs = strtoul(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-m mcu] [-f hz] [-p poll_us] [-n events] [-s seed]"
+					" [-l lead_us] firmware.elf benchUsb_address\n", argv[0]);
+			return 2;
+		}
+	}
+	if(argc - optind != 2 || !pollUs || !events) {
+		fprintf(stderr, "%s: need firmware.elf and benchUsb_address\n", argv[0]);
+		return 2;
+	}
+
+	memset(&firmware, 0, sizeof(firmware));
+	if(elf_read_firmware(argv[optind], &firmware)) {
+		fprintf(stderr, "%s: cannot read %s\n", argv[0], argv[optind]);
+		return 1;
+	}
+	mailbox = strtoul(argv[optind + 1], NULL, 16) & 0xffff;	// avr-nm prints 0x80xxxx
+	if(!firmware.mmcu[0])
+		snprintf(firmware.mmcu, sizeof(firmware.mmcu), "%s", mmcu);
+	if(!firmware.frequency)
+		firmware.frequency = frequency;
+
+	avr = avr_make_mcu_by_name(firmware.mmcu);
+	if(!avr) {
+		fprintf(stderr, "%s: unknown mcu %s\n", argv[0], firmware.mmcu);
+		return 1;
+	}
+	avr_init(avr);
+	avr_load_firmware(avr, &firmware);
+	avr->log = LOG_ERROR;
+
+	for(i = 0; i < sizeof(pullUps) / sizeof(pullUps[0]); i++) {
+		uint8_t bit;
+
+		for(bit = 0; bit < 8; bit++)
+			if(pullUps[i].mask & (1 << bit))
+				setPin(pullUps[i].port, bit, 1);
+	}
+
+	ms = avr->frequency / 1000;
+	poll = (avr_cycle_count_t)avr->frequency * pollUs / 1000000;
+
+	// boot, then take whatever the firmware reports with nothing pressed
+	runUntil(BOOT_MS * ms);
+	for(nextPoll = avr->cycle + poll; nextPoll < (BOOT_MS + SETTLE_MS) * ms; nextPoll += poll) {
+		runUntil(nextPoll);
+		hostPoll();
+	}
+	memcpy(idleReport, hostReport, sizeof(idleReport));
+	leadCount = 0;		// refreshes while booting do not count
+
+	latency[EDGE_PRESS] = calloc(events, sizeof(avr_cycle_count_t));
+	latency[EDGE_RELEASE] = calloc(events, sizeof(avr_cycle_count_t));
+
+	// press and release every input in turn
+	edge = 0;
+	pending = nextPoll + random32() % (GAP_MS * ms);
+	while(edge < 2 * events || waiting) {
+		if(edge < 2 * events && pending < nextPoll) {
+			const input_t *in = &inputs[(edge / 2) % INPUTS];
+
+			runUntil(pending);
+			edgeType = edge & 1;
+			setPin(in->port, in->bit, edgeType == EDGE_RELEASE);
+			edgeAt = avr->cycle;
+			waiting = 1;
+			edge++;
+			pending = edgeAt + (edgeType == EDGE_PRESS ?
+					HOLD_MS * ms + random32() % (HOLD_MS * ms) :
+					GAP_MS * ms + random32() % (GAP_MS * ms));
+			continue;
+		}
+
+		runUntil(nextPoll);
+		if(hostPoll() && waiting) {
+			int idle = !memcmp(hostReport, idleReport, sizeof(hostReport));
+
+			if(idle == (edgeType == EDGE_RELEASE)) {
+				latency[edgeType][count[edgeType]++] = avr->cycle - edgeAt;
+				waiting = 0;
+			}
+		}
+		if(waiting && avr->cycle - edgeAt >= HOLD_MS * ms) {
+			missed[edgeType]++;
+			waiting = 0;
+		}
+		nextPoll += poll;
+	}
+
+	printf("%s: %u us polls, %u presses\n", argv[optind], pollUs, events);
+	summary("press", latency[EDGE_PRESS], count[EDGE_PRESS], missed[EDGE_PRESS]);
+	summary("release", latency[EDGE_RELEASE], count[EDGE_RELEASE], missed[EDGE_RELEASE]);
+	if(leadCount)
+		lead = summary("refresh", leads, leadCount, 0);
+	if(leadUs && (!leadCount || lead > leadUs)) {
+		fprintf(stderr, leadCount ? "%s: refreshes land more than %u us before the poll\n" :
+				"%s: no report was refreshed\n", argv[0], leadUs);
+		return 1;
+	}
+
+	return missed[EDGE_PRESS] || missed[EDGE_RELEASE];
+}
@@ -0,0 +1,265 @@
+/*
+SOCD state-space checker
+========================
+Checks the SOCD machine of InputCore.c exhaustively against a specification.
+Every SOCD state reachable after socdSelect() is combined with every raw
+direction nibble, 4096 (state, input) lanes at most, and for every policy:
+
+- the resolved nibble and next state read back through resolveDirections()
+  are compared with the policy written as boolean equations, evaluated
+  bit-sliced over 64 lanes per word;
+- the resolved nibble never holds opposing directions or a direction that
+  is not held, and the next state records the raw and resolved pairs;
+- for every stick mode, buildReport() must give a hat switch that agrees
+  with the x/y and z/rz axes the build reports (CORE_FLAGS=-DREPORT_AXES=n),
+  and the same report again when the input is held for another frame, so
+  every transition settles in one frame.
+
+Each violation is printed with its state and input, the exit status is the
+number of failed checks (0 == all passed).
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "InputCore.h"
+
+#define LANES	4096			/* 256 states x 16 inputs */
+#define WORDS	(LANES / 64)
+
+#define LANE_STATE(l)	((l) >> 4)
+#define LANE_INPUT(l)	((l) & 0x0f)
+
+typedef uint64_t plane_t[WORDS];
+
+static const struct { const char *name; uint8_t policy; } policies[] = {
+	{ "neutral",		SOCD_NEUTRAL },
+	{ "up-priority",	SOCD_UP_PRIORITY },
+	{ "last-input",		SOCD_LAST_INPUT },
+};
+
+/* stick mode bits of config: left stick, digital pad, right stick */
+static const uint8_t stickBits[] = { (1<<1), (1<<2), (1<<3) };
+
+#if REPORT_AXES >= 2
+/* hat switch value of each resolved x/y, as the directionTable in InputCore.c */
+static uint8_t hatFor(uint8_t x, uint8_t y) {
+	static const uint8_t hats[3][3] = {
+		/* x: 0x00  0x80  0xff */
+		{  7,    0,    1 },	/* y 0x00 */
+		{  6,    8,    2 },	/* y 0x80 */
+		{  5,    4,    3 },	/* y 0xff */
+	};
+	int col = x == 0x00 ? 0 : x == 0x80 ? 1 : x == 0xff ? 2 : -1;
+	int row = y == 0x00 ? 0 : y == 0x80 ? 1 : y == 0xff ? 2 : -1;
+
+	return col < 0 || row < 0 ? 0xff : hats[row][col];
+}
+#endif
+
+static plane_t in[8], st[8];	/* bits of each lane's input and state */
+static plane_t res[4], next[8];	/* what resolveDirections() did */
+static plane_t reachable;
+static unsigned failures;
+
+static void setLane(uint64_t *plane, unsigned lane, int bit) {
+	if(bit)
+		plane[lane >> 6] |= (uint64_t)1 << (lane & 63);
+}
+
+static void report(const char *policy, const char *check, const uint64_t *bad) {
+	unsigned lane, count = 0;
+
+	for(lane = 0; lane < LANES; lane++) {
+		if(!(bad[lane >> 6] >> (lane & 63) & 1))
+			continue;
+		if(count++ < 8)
+			printf("  %s: %s fails for state 0x%02x input 0x%x\n",
+				   policy, check, LANE_STATE(lane), LANE_INPUT(lane));
+	}
+	if(count) {
+		printf("  %s: %s fails for %u lanes\n", policy, check, count);
+		failures++;
+	}
+}
+
+/*
+The policies per axis as equations of the raw pair n (n0: Up/Left, n1:
+Down/Right), the raw pair of the last frame p and its resolution q,
+giving the resolved pair r.
+*/
+static void specAxis(int policy, uint64_t n0, uint64_t n1, uint64_t p0, uint64_t p1,
+					 uint64_t q0, uint64_t q1, uint64_t *r0, uint64_t *r1, int vertical) {
+	uint64_t both = n0 & n1;
+
+	switch(policy) {
+	case SOCD_UP_PRIORITY:
+		if(vertical) {
+			*r0 = n0;			// Up wins
+			*r1 = n1 & ~n0;
+			break;
+		}
+		/* fall through, Left+Right is neutral */
+	case SOCD_NEUTRAL:
+		*r0 = n0 & ~n1;
+		*r1 = n1 & ~n0;
+		break;
+	case SOCD_LAST_INPUT:
+		// the one pressed later wins, both new is neutral, both held keeps
+		*r0 = (n0 & ~n1) | (both & p1 & ~p0) | (both & p0 & p1 & q0);
+		*r1 = (n1 & ~n0) | (both & p0 & ~p1) | (both & p0 & p1 & q1);
+		break;
+	}
+}
+
+static void checkTables(const char *name, uint8_t policy) {
+	plane_t expect[4], bad;
+	unsigned w, b, lane;
+	uint8_t seen[256], queue[256];
+	unsigned head = 0, tail = 0;
+
+	memset(res, 0, sizeof(res));
+	memset(next, 0, sizeof(next));
+	memset(reachable, 0, sizeof(reachable));
+
+	// states reachable from socdSelect()
+	memset(seen, 0, sizeof(seen));
+	socdSelect(policy);
+	seen[socdState] = 1;
+	queue[tail++] = socdState;
+	while(head < tail) {
+		uint8_t s = queue[head++];
+		uint8_t n;
+
+		for(n = 0; n < 16; n++) {
+			socdState = s;
+			resolveDirections(n);
+			if(!seen[socdState]) {
+				seen[socdState] = 1;
+				queue[tail++] = socdState;
+			}
+		}
+	}
+	printf("%s: %u reachable states\n", name, tail);
+
+	for(lane = 0; lane < LANES; lane++) {
+		uint8_t r;
+
+		socdState = LANE_STATE(lane);
+		r = resolveDirections(LANE_INPUT(lane));
+		for(b = 0; b < 4; b++)
+			setLane(res[b], lane, r >> b & 1);
+		for(b = 0; b < 8; b++)
+			setLane(next[b], lane, socdState >> b & 1);
+		setLane(reachable, lane, seen[LANE_STATE(lane)]);
+	}
+
+	for(w = 0; w < WORDS; w++) {
+		// vertical: input bits 0-1, state bits 0-3; horizontal: 2-3 and 4-7
+		specAxis(policy, in[0][w], in[1][w], st[2][w], st[3][w], st[0][w], st[1][w],
+				 &expect[0][w], &expect[1][w], 1);
+		specAxis(policy, in[2][w], in[3][w], st[6][w], st[7][w], st[4][w], st[5][w],
+				 &expect[2][w], &expect[3][w], 0);
+	}
+
+	for(w = 0; w < WORDS; w++)
+		bad[w] = ((res[0][w] ^ expect[0][w]) | (res[1][w] ^ expect[1][w]) |
+				  (res[2][w] ^ expect[2][w]) | (res[3][w] ^ expect[3][w])) & reachable[w];
+	report(name, "specification", bad);
+
+	for(w = 0; w < WORDS; w++)
+		bad[w] = ((res[0][w] & res[1][w]) | (res[2][w] & res[3][w])) & reachable[w];
+	report(name, "no opposing directions", bad);
+
+	for(w = 0; w < WORDS; w++)
+		bad[w] = ((res[0][w] & ~in[0][w]) | (res[1][w] & ~in[1][w]) |
+				  (res[2][w] & ~in[2][w]) | (res[3][w] & ~in[3][w])) & reachable[w];
+	report(name, "only held directions", bad);
+
+	for(w = 0; w < WORDS; w++)
+		bad[w] = ((next[0][w] ^ res[0][w]) | (next[1][w] ^ res[1][w]) |
+				  (next[2][w] ^ in[0][w]) | (next[3][w] ^ in[1][w]) |
+				  (next[4][w] ^ res[2][w]) | (next[5][w] ^ res[3][w]) |
+				  (next[6][w] ^ in[2][w]) | (next[7][w] ^ in[3][w])) & reachable[w];
+	report(name, "next state", bad);
+}
+
+static void checkReports(const char *name, uint8_t policy) {
+	plane_t badHat, badSettle;
+	unsigned mode, lane;
+
+	socdSelect(policy);
+	memset(badHat, 0, sizeof(badHat));
+	memset(badSettle, 0, sizeof(badSettle));
+
+	for(mode = 0; mode < 8; mode++) {
+		uint8_t config = 0;
+		unsigned b;
+
+		for(b = 0; b < 3; b++)
+			if(mode & (1 << b))
+				config |= stickBits[b];
+		reportSelect(config);
+		config = reportConfig;	// as the build's axes allow, see Report layout
+
+		for(lane = 0; lane < LANES; lane++) {
+			report_t first, again;
+			input_t input = { 0, LANE_INPUT(lane) };
+			uint8_t shown[3], hat = 0xfe;
+
+			if(!(reachable[lane >> 6] >> (lane & 63) & 1))
+				continue;
+			socdState = LANE_STATE(lane);
+			buildReport(&first, &input, 1, 1);
+			buildReport(&again, &input, 1, 1);
+
+			// every enabled output shows the same direction, the others rest
+			shown[0] = shown[2] = 0x08;
+#if REPORT_AXES >= 2
+			shown[0] = hatFor(first.x, first.y);
+#endif
+			shown[1] = first.hatswitch;
+#if REPORT_AXES >= 4
+			shown[2] = hatFor(first.z, first.rz);
+#endif
+			for(b = 0; b < 3; b++) {
+				if(!(config & stickBits[b])) {
+					if(shown[b] != 0x08)
+						setLane(badHat, lane, 1);
+				}
+				else if(hat == 0xfe)
+					hat = shown[b];
+				else if(shown[b] != hat)
+					setLane(badHat, lane, 1);
+				if(shown[b] > 0x08)
+					setLane(badHat, lane, 1);
+			}
+
+			if(memcmp(&first, &again, sizeof(first)))
+				setLane(badSettle, lane, 1);
+		}
+	}
+
+	report(name, "hat agrees with axes", badHat);
+	report(name, "settles in one frame", badSettle);
+}
+
+int main(void) {
+	unsigned lane, b, p;
+
+	for(lane = 0; lane < LANES; lane++) {
+		for(b = 0; b < 4; b++)
+			setLane(in[b], lane, LANE_INPUT(lane) >> b & 1);
+		for(b = 0; b < 8; b++)
+			setLane(st[b], lane, LANE_STATE(lane) >> b & 1);
+	}
+
+	for(p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+		checkTables(policies[p].name, policies[p].policy);
+		checkReports(policies[p].name, policies[p].policy);
+	}
+
+	printf(failures ? "%u checks failed\n" : "all checks passed\n", failures);
+	return failures;
+}
@@ -0,0 +1,23 @@
+/*
+V-USB stand-in for the simavr bench, see include/usbdrv.h.
+*/
+#include <string.h>
+#include "usbdrv.h"
+
+volatile benchUsb_t benchUsb;
+uchar *usbMsgPtr;
+
+void usbInit(void) {
+	benchUsb.state = BENCH_IDLE;
+}
+
+void usbPoll(void) {
+}
+
+// Like V-USB the endpoint NAKs while the report is copied
+void usbSetInterrupt(uchar *data, uchar len) {
+	benchUsb.state = BENCH_WRITING;
+	memcpy((void *)benchUsb.data, data, len);
+	benchUsb.len = len;
+	benchUsb.state = BENCH_QUEUED;
+}
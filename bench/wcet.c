@@ -0,0 +1,792 @@
+/*
+Static worst-case execution time
+================================
+Reads the disassembly of a firmware build (avr-objdump -d --no-show-raw-insn)
+and computes the worst-case cycle count of functions, following calls into
+their callees, libc and libgcc included. Cycle counts are those of the
+classic AVR core of the ATmega8 and MegaX8 (2-byte PC): a taken branch costs
+one cycle more, a skip one or two more depending on the skipped instruction.
+
+Loops need a bound, given per function as the most times any of its loops
+may run its header (-l name=N); code inlined into a function is bounded by
+that function's entry. A loop without a bound is an error, not a guess.
+Nested loops are bounded by N at every level, so bounds only ever
+overestimate. The longest path through a loop body is taken every time.
+
+Indirect calls resolve to the functions of the current config (-c). The
+input core calls exactly one report builder per config, so giving every
+config with its builder covers every config byte: the other config bits
+only select tables and constants, not code paths. Indirect calls in a
+function given with -i resolve to its own list in every config instead,
+for calls through a table such as the chord actions. Indirect jumps are
+errors; build with -fno-jump-tables if a switch turns into one.
+
+A root "name@loop" is the cost of one iteration of the largest loop in the
+function, for main's event loop, which never returns. The bench builds link
+usbstub.c, so it leaves out V-USB's usbPoll. Interrupts are not included:
+every cycle count is that of the code alone.
+
+usage: wcet [-l name=bound]... [-c label=name[,name]...]... [-i name=name[,name]...]...
+            file.dis root[:budget]...
+
+Prints one row per config and one column per root and exits nonzero if any
+count is over its budget or cannot be computed.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+
+#define MAX_LINE	512
+#define MAX_BOUNDS	64
+#define MAX_CONFIGS	32
+#define MAX_ROOTS	16
+#define MAX_TARGETS	16
+
+#define EXIT		(-1)	/* successor of ret, reti and tail calls */
+
+enum { PLAIN, BRANCH, SKIP, JUMP, CALL, ICALL, IJMP, RET, UNKNOWN };
+
+typedef struct {
+	uint32_t	addr;
+	uint32_t	target;		/* of branches, jumps and calls */
+	uint8_t		size;		/* bytes */
+	uint8_t		kind;
+	uint8_t		cycles;		/* not taken / not skipping */
+	uint8_t		reported;	/* an error was printed for it */
+} insn_t;
+
+typedef struct {
+	char		name[64];
+	int			first, count;	/* range of insns */
+	long		wcet;			/* of the current config, -1 until known */
+	uint8_t		state;			/* 0: not analyzed, 1: in progress, 2: done */
+	uint8_t		called;			/* entered by calls, not a label inside another */
+} func_t;
+
+typedef struct {
+	int			to;		/* index in the function or EXIT */
+	long		cost;
+} edge_t;
+
+static const struct { const char *name; uint8_t cycles, kind; } opcodes[] = {
+	{ "adc", 1, PLAIN },	{ "add", 1, PLAIN },	{ "adiw", 2, PLAIN },	{ "and", 1, PLAIN },
+	{ "andi", 1, PLAIN },	{ "asr", 1, PLAIN },	{ "bclr", 1, PLAIN },	{ "bld", 1, PLAIN },
+	{ "bset", 1, PLAIN },	{ "bst", 1, PLAIN },	{ "cbi", 2, PLAIN },	{ "cbr", 1, PLAIN },
+	{ "clc", 1, PLAIN },	{ "clh", 1, PLAIN },	{ "cli", 1, PLAIN },	{ "cln", 1, PLAIN },
+	{ "clr", 1, PLAIN },	{ "cls", 1, PLAIN },	{ "clt", 1, PLAIN },	{ "clv", 1, PLAIN },
+	{ "clz", 1, PLAIN },	{ "com", 1, PLAIN },	{ "cp", 1, PLAIN },		{ "cpc", 1, PLAIN },
+	{ "cpi", 1, PLAIN },	{ "dec", 1, PLAIN },	{ "eor", 1, PLAIN },	{ "fmul", 2, PLAIN },
+	{ "fmuls", 2, PLAIN },	{ "fmulsu", 2, PLAIN },	{ "in", 1, PLAIN },		{ "inc", 1, PLAIN },
+	{ "ld", 2, PLAIN },		{ "ldd", 2, PLAIN },	{ "ldi", 1, PLAIN },	{ "lds", 2, PLAIN },
+	{ "lpm", 3, PLAIN },	{ "lsl", 1, PLAIN },	{ "lsr", 1, PLAIN },	{ "mov", 1, PLAIN },
+	{ "movw", 1, PLAIN },	{ "mul", 2, PLAIN },	{ "muls", 2, PLAIN },	{ "mulsu", 2, PLAIN },
+	{ "neg", 1, PLAIN },	{ "nop", 1, PLAIN },	{ "or", 1, PLAIN },		{ "ori", 1, PLAIN },
+	{ "out", 1, PLAIN },	{ "pop", 2, PLAIN },	{ "push", 2, PLAIN },	{ "rol", 1, PLAIN },
+	{ "ror", 1, PLAIN },	{ "sbc", 1, PLAIN },	{ "sbci", 1, PLAIN },	{ "sbi", 2, PLAIN },
+	{ "sbiw", 2, PLAIN },	{ "sbr", 1, PLAIN },	{ "sec", 1, PLAIN },	{ "seh", 1, PLAIN },
+	{ "sei", 1, PLAIN },	{ "sen", 1, PLAIN },	{ "ser", 1, PLAIN },	{ "ses", 1, PLAIN },
+	{ "set", 1, PLAIN },	{ "sev", 1, PLAIN },	{ "sez", 1, PLAIN },	{ "sleep", 1, PLAIN },
+	{ "spm", 4, PLAIN },	{ "st", 2, PLAIN },		{ "std", 2, PLAIN },	{ "sts", 2, PLAIN },
+	{ "sub", 1, PLAIN },	{ "subi", 1, PLAIN },	{ "swap", 1, PLAIN },	{ "tst", 1, PLAIN },
+	{ "wdr", 1, PLAIN },	{ "break", 1, PLAIN },
+	{ "cpse", 1, SKIP },	{ "sbrc", 1, SKIP },	{ "sbrs", 1, SKIP },	{ "sbic", 1, SKIP },
+	{ "sbis", 1, SKIP },
+	{ "rjmp", 2, JUMP },	{ "jmp", 3, JUMP },
+	{ "rcall", 3, CALL },	{ "call", 4, CALL },
+	{ "icall", 3, ICALL },	{ "ijmp", 2, IJMP },
+	{ "ret", 4, RET },		{ "reti", 4, RET },
+};
+
+static insn_t *insns;
+static int insnCount;
+static func_t *funcs;
+static int funcCount;
+
+static struct { char name[64]; long bound; } bounds[MAX_BOUNDS];
+static int boundCount;
+
+typedef struct { const char *label, *names; int targets[MAX_TARGETS]; int count; } targets_t;
+
+static targets_t configs[MAX_CONFIGS];
+static int configCount;
+static targets_t indirect[MAX_CONFIGS];	/* labeled with the calling function */
+static int indirectCount;
+static int config;				/* current */
+
+static long loopIter;			/* of the largest loop, for name@loop roots */
+static int loopSize;
+static int failed;
+
+static void *grow(void *p, int count, size_t size) {
+	// doubles at powers of two
+	if(count & (count - 1))
+		return p;
+	p = realloc(p, (count ? 2 * count : 1) * size);
+	if(!p) {
+		fprintf(stderr, "wcet: out of memory\n");
+		exit(2);
+	}
+	return p;
+}
+
+static void decode(insn_t *in, const char *mnemonic, const char *operands, const char *comment) {
+	unsigned i;
+
+	in->kind = UNKNOWN;
+	in->cycles = 0;
+	for(i = 0; i < sizeof(opcodes) / sizeof(opcodes[0]); i++) {
+		if(!strcmp(opcodes[i].name, mnemonic)) {
+			in->kind = opcodes[i].kind;
+			in->cycles = opcodes[i].cycles;
+			break;
+		}
+	}
+	if(in->kind == UNKNOWN && mnemonic[0] == 'b' && mnemonic[1] == 'r') {
+		in->kind = BRANCH;		// brne, brcs, brbs, ...
+		in->cycles = 1;
+	}
+
+	in->size = !strcmp(mnemonic, "call") || !strcmp(mnemonic, "jmp") ||
+			   !strcmp(mnemonic, "lds") || !strcmp(mnemonic, "sts") ? 4 : 2;
+
+	// absolute targets are in the comment, "; 0x1a2 <name+0x4>"
+	if(comment)
+		in->target = strtoul(comment, NULL, 16);
+	else if(!strncmp(operands, "0x", 2))
+		in->target = strtoul(operands, NULL, 16);
+	else if(operands[0] == '.')
+		in->target = in->addr + 2 + strtol(operands + 1, NULL, 0);
+	else {
+		const char *last = strrchr(operands, ',');
+
+		// brbs/brbc carry the offset after the bit
+		in->target = last && last[1] == '.' ? in->addr + 2 + strtol(last + 2, NULL, 0) : 0;
+	}
+}
+
+static void readDisassembly(FILE *f) {
+	char line[MAX_LINE];
+
+	while(fgets(line, sizeof(line), f)) {
+		char *p = line, *end, *mnemonic, *operands, *comment;
+		unsigned long addr = strtoul(line, &end, 16);
+
+		// "000001a2 <name>:" starts a function
+		if(end != line && !strncmp(end, " <", 2)) {
+			char *close = strchr(end, '>');
+
+			if(!close)
+				continue;
+			funcs = grow(funcs, funcCount, sizeof(func_t));
+			snprintf(funcs[funcCount].name, sizeof(funcs[funcCount].name), "%.*s",
+					 (int)(close - end - 2), end + 2);
+			funcs[funcCount].first = insnCount;
+			funcs[funcCount].count = 0;
+			funcs[funcCount].called = 0;
+			funcCount++;
+			continue;
+		}
+
+		// "     1a2:\tmnemonic\toperands\t; comment"
+		while(isspace((unsigned char)*p))
+			p++;
+		addr = strtoul(p, &end, 16);
+		if(end == p || *end != ':' || !funcCount)
+			continue;
+		p = end + 1;
+		while(isspace((unsigned char)*p))
+			p++;
+		if(!*p)
+			continue;
+
+		comment = strchr(p, ';');
+		if(comment)
+			*comment++ = 0;
+		mnemonic = p;
+		while(*p && !isspace((unsigned char)*p))
+			p++;
+		if(*p)
+			*p++ = 0;
+		while(isspace((unsigned char)*p))
+			p++;
+		operands = p;
+		for(end = operands + strlen(operands); end > operands && isspace((unsigned char)end[-1]); )
+			*--end = 0;
+
+		insns = grow(insns, insnCount, sizeof(insn_t));
+		insns[insnCount].addr = addr;
+		insns[insnCount].reported = 0;
+		decode(&insns[insnCount], mnemonic, operands, comment);
+		insnCount++;
+		funcs[funcCount - 1].count++;
+	}
+}
+
+/*
+Assembler code, libgcc's in particular, has labels inside functions that
+show up as symbols of their own. Symbols nothing calls are merged into the
+function before them, so their loops stay in one piece. A jump to a symbol
+the code before it cannot fall into is a tail call, "rjmp memcpy" at -Os.
+*/
+static int funcAt(uint32_t addr);
+
+static void mergeLabels(void) {
+	int i, n = 0;
+
+	for(i = 0; i < insnCount; i++) {
+		if(insns[i].kind == CALL || insns[i].kind == JUMP) {
+			int fn = funcAt(insns[i].target);
+
+			if(fn < 0)
+				continue;
+			if(insns[i].kind == JUMP && funcs[fn].first > 0) {
+				uint8_t before = insns[funcs[fn].first - 1].kind;
+
+				if(before != RET && before != JUMP && before != IJMP)
+					continue;
+			}
+			funcs[fn].called = 1;
+		}
+	}
+	for(i = 0; i < funcCount; i++) {
+		if(n && !funcs[i].called && funcs[n - 1].first + funcs[n - 1].count == funcs[i].first)
+			funcs[n - 1].count += funcs[i].count;
+		else
+			funcs[n++] = funcs[i];
+	}
+	funcCount = n;
+}
+
+static int findFunc(const char *name) {
+	int i;
+
+	for(i = 0; i < funcCount; i++)
+		if(!strcmp(funcs[i].name, name))
+			return i;
+	return -1;
+}
+
+// Marks the functions of "name,name..." as called, a root's ":budget" or "@loop" ends it
+static void markCalled(const char *names) {
+	while(*names && *names != ':' && *names != '@') {
+		size_t len = strcspn(names, ",:@");
+		int i;
+
+		for(i = 0; i < funcCount; i++)
+			if(strlen(funcs[i].name) == len && !strncmp(funcs[i].name, names, len))
+				funcs[i].called = 1;
+		names += len;
+		if(*names == ',')
+			names++;
+	}
+}
+
+static int funcAt(uint32_t addr) {
+	int i;
+
+	for(i = 0; i < funcCount; i++)
+		if(funcs[i].count && insns[funcs[i].first].addr == addr)
+			return i;
+	return -1;
+}
+
+// Index of the instruction at addr within function f, -1 if outside
+static int indexAt(const func_t *f, uint32_t addr) {
+	int lo = 0, hi = f->count - 1;
+
+	while(lo <= hi) {
+		int mid = (lo + hi) / 2;
+		uint32_t a = insns[f->first + mid].addr;
+
+		if(a == addr)
+			return mid;
+		if(a < addr)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return -1;
+}
+
+static long wcet(int fn);
+
+// Prints an error once per instruction, i < 0 for the function itself
+static void error(const func_t *f, int i, const char *what) {
+	insn_t *in = &insns[f->first + (i < 0 ? 0 : i)];
+
+	failed = 1;
+	if(i >= 0 && in->reported)
+		return;
+	if(i >= 0) {
+		in->reported = 1;
+		fprintf(stderr, "wcet: %s at 0x%lx in %s\n", what, (unsigned long)in->addr, f->name);
+	}
+	else
+		fprintf(stderr, "wcet: %s in %s\n", what, f->name);
+}
+
+// The cost of a call or tail call to addr, -1 if unknown
+static long callCost(const func_t *f, int i, uint32_t addr) {
+	int callee = funcAt(addr);
+	long c;
+
+	if(callee < 0) {
+		error(f, i, "call into the middle of a function");
+		return -1;
+	}
+	c = wcet(callee);
+	if(c < 0)
+		failed = 1;
+	return c;
+}
+
+// Successors of instruction i of f with the cycles spent getting there
+static int successors(const func_t *f, int i, edge_t *out) {
+	const insn_t *in = &insns[f->first + i];
+	const targets_t *to;
+	int n = 0, t, k;
+	long c;
+
+	switch(in->kind) {
+	case PLAIN:
+		out[n].to = i + 1; out[n++].cost = in->cycles;
+		break;
+	case BRANCH:
+		out[n].to = i + 1; out[n++].cost = 1;
+		out[n].to = indexAt(f, in->target); out[n++].cost = 2;
+		break;
+	case SKIP:
+		out[n].to = i + 1; out[n++].cost = 1;
+		if(i + 1 < f->count) {
+			out[n].to = i + 2;
+			out[n++].cost = insns[f->first + i + 1].size == 4 ? 3 : 2;
+		}
+		break;
+	case JUMP:
+		t = indexAt(f, in->target);
+		if(t >= 0) {
+			out[n].to = t; out[n++].cost = in->cycles;
+		}
+		else if((c = callCost(f, i, in->target)) >= 0) {
+			out[n].to = EXIT; out[n++].cost = in->cycles + c;	// tail call
+		}
+		break;
+	case CALL:
+		if((c = callCost(f, i, in->target)) >= 0) {
+			out[n].to = i + 1; out[n++].cost = in->cycles + c;
+		}
+		break;
+	case ICALL:
+		to = configCount ? &configs[config] : NULL;
+		for(k = 0; k < indirectCount; k++)
+			if(!strcmp(indirect[k].label, f->name))
+				to = &indirect[k];
+		if(!to || !to->count) {
+			error(f, i, "indirect call without a config");
+			break;
+		}
+		out[n].to = i + 1; out[n].cost = 0;
+		for(k = 0; k < to->count; k++) {
+			c = wcet(to->targets[k]);
+			if(c < 0)
+				failed = 1;
+			else if(in->cycles + c > out[n].cost)
+				out[n].cost = in->cycles + c;
+		}
+		n++;
+		break;
+	case RET:
+		out[n].to = EXIT; out[n++].cost = in->cycles;
+		break;
+	case IJMP:
+		error(f, i, "indirect jump");
+		break;
+	default:
+		error(f, i, "unknown instruction");
+		break;
+	}
+
+	for(k = 0; k < n; k++) {
+		if(out[k].to == f->count && f->first + f->count < insnCount &&
+		   (c = callCost(f, i, insns[f->first + f->count].addr)) >= 0) {
+			out[k].to = EXIT;	// falls through into the next function
+			out[k].cost += c;
+		}
+		if(out[k].to != EXIT && (out[k].to < 0 || out[k].to >= f->count)) {
+			error(f, i, "branch out of the function");
+			return 0;
+		}
+	}
+	return n;
+}
+
+static long boundOf(const func_t *f) {
+	int i;
+
+	for(i = 0; i < boundCount; i++)
+		if(!strcmp(bounds[i].name, f->name))
+			return bounds[i].bound;
+	return -1;
+}
+
+/*
+Longest paths from entry to every instruction of the region in[] of f,
+into dist[], and to EXIT, returned. Loops are the strongly connected
+components, found with Tarjan's algorithm and taken in topological order.
+A loop is entered through its header only, costs bound - 1 iterations of its
+longest round trip, found the same way with the edges back into the header
+cut, plus the path from the header to wherever it is left.
+*/
+typedef struct {
+	const func_t *f;
+	const uint8_t *in;
+	int entry, cut;
+	int *index, *low, *stack, *order, *comp;
+	uint8_t *onStack;
+	int counter, sp, orderCount;
+} tarjan_t;
+
+static int edgeInRegion(const tarjan_t *t, int to) {
+	return to != EXIT && t->in[to] && !(t->cut && to == t->entry);
+}
+
+static void strongConnect(tarjan_t *t, int v) {
+	edge_t e[2];
+	int n, k, w;
+
+	t->index[v] = t->low[v] = t->counter++;
+	t->stack[t->sp++] = v;
+	t->onStack[v] = 1;
+
+	n = successors(t->f, v, e);
+	for(k = 0; k < n; k++) {
+		if(!edgeInRegion(t, e[k].to))
+			continue;
+		w = e[k].to;
+		if(t->index[w] < 0) {
+			strongConnect(t, w);
+			if(t->low[w] < t->low[v])
+				t->low[v] = t->low[w];
+		}
+		else if(t->onStack[w] && t->index[w] < t->low[v])
+			t->low[v] = t->index[w];
+	}
+
+	if(t->low[v] == t->index[v]) {
+		// pop the component, recorded in reverse topological order
+		do {
+			w = t->stack[--t->sp];
+			t->onStack[w] = 0;
+			t->comp[w] = v;
+			t->order[t->orderCount++] = w;
+		} while(w != v);
+	}
+}
+
+static long longestPaths(const func_t *f, const uint8_t *in, int entry, int cut, int top, long *dist) {
+	int count = f->count, i, k, n, end;
+	long exitDist = -1;
+	edge_t e[2];
+	tarjan_t t;
+
+	t.f = f; t.in = in; t.entry = entry; t.cut = cut;
+	t.index = malloc(count * sizeof(int));
+	t.low = malloc(count * sizeof(int));
+	t.stack = malloc(count * sizeof(int));
+	t.order = malloc(count * sizeof(int));
+	t.comp = malloc(count * sizeof(int));
+	t.onStack = calloc(count, 1);
+	t.counter = t.sp = t.orderCount = 0;
+	for(i = 0; i < count; i++) {
+		t.index[i] = -1;
+		if(in[i])
+			dist[i] = -1;
+	}
+	strongConnect(&t, entry);
+	dist[entry] = 0;
+
+	// components in topological order, each a run of order[] ending at its root
+	for(end = t.orderCount; end > 0; ) {
+		int root = t.comp[t.order[end - 1]], start = end - 1, header = -1, size, loop = 0;
+
+		while(start > 0 && t.comp[t.order[start - 1]] == root)
+			start--;
+		size = end - start;
+
+		for(i = start; i < end; i++) {
+			int v = t.order[i];
+
+			if(v == entry || dist[v] >= 0) {
+				if(header >= 0 && header != v) {
+					error(f, v, "loop with a second entry");
+					goto done;
+				}
+				header = v;
+			}
+			n = successors(f, v, e);
+			for(k = 0; k < n; k++)
+				if(edgeInRegion(&t, e[k].to) && t.comp[e[k].to] == root)
+					loop = 1;
+		}
+		if(header < 0)
+			goto next;		// unreachable
+
+		if(loop) {
+			uint8_t *body = calloc(count, 1);
+			long *inner = malloc(count * sizeof(long)), iter = -1, bound = boundOf(f);
+
+			for(i = start; i < end; i++)
+				body[t.order[i]] = 1;
+			longestPaths(f, body, header, 1, 0, inner);
+			for(i = start; i < end; i++) {
+				int v = t.order[i];
+
+				n = successors(f, v, e);
+				for(k = 0; k < n; k++)
+					if(e[k].to == header && inner[v] >= 0 && inner[v] + e[k].cost > iter)
+						iter = inner[v] + e[k].cost;
+			}
+			if(top && size > loopSize) {
+				loopSize = size;
+				loopIter = iter;
+			}
+			if(bound < 0) {
+				if(top)
+					bound = 1;	// the outermost loop of a name@loop root
+				else {
+					error(f, header, "loop without a bound");
+					bound = 1;
+				}
+			}
+			for(i = start; i < end; i++) {
+				int v = t.order[i];
+
+				if(inner[v] >= 0)
+					dist[v] = dist[header] + (bound - 1) * iter + inner[v];
+			}
+			free(body);
+			free(inner);
+		}
+
+		// leave the component
+		for(i = start; i < end; i++) {
+			int v = t.order[i];
+
+			if(dist[v] < 0)
+				continue;
+			n = successors(f, v, e);
+			for(k = 0; k < n; k++) {
+				if(e[k].to == EXIT) {
+					if(dist[v] + e[k].cost > exitDist)
+						exitDist = dist[v] + e[k].cost;
+				}
+				else if(edgeInRegion(&t, e[k].to) && t.comp[e[k].to] != root &&
+						dist[v] + e[k].cost > dist[e[k].to])
+					dist[e[k].to] = dist[v] + e[k].cost;
+			}
+		}
+next:
+		end = start;
+	}
+
+done:
+	free(t.index); free(t.low); free(t.stack); free(t.order); free(t.comp); free(t.onStack);
+	return exitDist;
+}
+
+static long analyze(int fn, int top) {
+	func_t *f = &funcs[fn];
+	uint8_t *in;
+	long *dist, exitDist;
+
+	if(!f->count) {
+		error(f, -1, "empty function");
+		return -1;
+	}
+	in = malloc(f->count);
+	dist = malloc(f->count * sizeof(long));
+	memset(in, 1, f->count);
+	exitDist = longestPaths(f, in, 0, 0, top, dist);
+	free(in);
+	free(dist);
+	return exitDist;
+}
+
+// Worst case of a call to function fn, -1 if unknown
+static long wcet(int fn) {
+	func_t *f = &funcs[fn];
+	int outer = failed;
+
+	if(f->state == 1) {
+		error(f, -1, "recursion");
+		return -1;
+	}
+	if(f->state == 0) {
+		f->state = 1;
+		failed = 0;
+		f->wcet = analyze(fn, 0);
+		if(f->wcet < 0 && !failed)
+			error(f, -1, "no return");
+		if(failed)
+			f->wcet = -1;	// a partial count is no bound
+		f->state = 2;
+		failed |= outer;
+	}
+	return f->wcet;
+}
+
+// Looks up the functions named by t, 0 if one is missing
+static int resolve(targets_t *t) {
+	char *name = (char *)t->names, *next;
+	int i;
+
+	t->count = 0;
+	for(; name && *name; name = next) {
+		next = strchr(name, ',');
+		if(next)
+			*next++ = 0;
+		i = findFunc(name);
+		if(i < 0) {
+			fprintf(stderr, "wcet: no function %s\n", name);
+			return 0;
+		}
+		if(t->count < MAX_TARGETS)
+			t->targets[t->count++] = i;
+	}
+	return 1;
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "usage: %s [-l name=bound]... [-c label=name[,name]...]... [-i name=name[,name]...]...\n"
+			"            file.dis root[:budget]...\n", name);
+	exit(2);
+}
+
+int main(int argc, char *argv[]) {
+	char rootName[MAX_ROOTS][64];
+	long budget[MAX_ROOTS];
+	int roots = 0, over = 0, a, r, i, c;
+	FILE *f;
+
+	for(a = 1; a < argc && argv[a][0] == '-'; a++) {
+		char *eq = argc > a + 1 ? strchr(argv[a + 1], '=') : NULL;
+
+		if(!eq || argv[a][2])
+			usage(argv[0]);
+		*eq++ = 0;
+		if(argv[a][1] == 'l' && boundCount < MAX_BOUNDS) {
+			snprintf(bounds[boundCount].name, sizeof(bounds[0].name), "%s", argv[a + 1]);
+			bounds[boundCount++].bound = strtol(eq, NULL, 0);
+		}
+		else if(argv[a][1] == 'c' && configCount < MAX_CONFIGS) {
+			// targets are resolved once the disassembly is read
+			configs[configCount].label = argv[a + 1];
+			configs[configCount++].names = eq;
+		}
+		else if(argv[a][1] == 'i' && indirectCount < MAX_CONFIGS) {
+			indirect[indirectCount].label = argv[a + 1];
+			indirect[indirectCount++].names = eq;
+		}
+		else
+			usage(argv[0]);
+		a++;
+	}
+	if(argc - a < 2 || argc - a - 1 > MAX_ROOTS)
+		usage(argv[0]);
+
+	f = fopen(argv[a], "r");
+	if(!f) {
+		fprintf(stderr, "wcet: cannot read %s\n", argv[a]);
+		return 2;
+	}
+	readDisassembly(f);
+	fclose(f);
+	for(c = 0; c < configCount; c++)
+		markCalled(configs[c].names);
+	for(c = 0; c < indirectCount; c++)
+		markCalled(indirect[c].names);
+	for(r = a + 1; r < argc; r++)
+		markCalled(argv[r]);
+	mergeLabels();
+
+	for(c = 0; c < configCount; c++)
+		if(!resolve(&configs[c]))
+			return 2;
+	for(c = 0; c < indirectCount; c++)
+		if(!resolve(&indirect[c]))
+			return 2;
+
+	for(r = 0; r < argc - a - 1; r++, roots++) {
+		char *colon;
+
+		snprintf(rootName[r], sizeof(rootName[r]), "%s", argv[a + 1 + r]);
+		colon = strchr(rootName[r], ':');
+		budget[r] = colon ? strtol(colon + 1, NULL, 0) : -1;
+		if(colon)
+			*colon = 0;
+	}
+
+	printf("%-12s", argv[a]);
+	for(r = 0; r < roots; r++)
+		printf(" %18s", rootName[r]);
+	printf("\n");
+
+	for(c = 0; c < (configCount ? configCount : 1); c++) {
+		config = c;
+		for(i = 0; i < funcCount; i++)
+			funcs[i].state = 0;
+
+		printf("%-12s", configCount ? configs[c].label : "");
+		for(r = 0; r < roots; r++) {
+			char name[64], *at;
+			long cycles;
+			int fn;
+
+			snprintf(name, sizeof(name), "%s", rootName[r]);
+			at = strchr(name, '@');
+			if(at)
+				*at = 0;
+			fn = findFunc(name);
+			failed = 0;
+			if(fn < 0) {
+				fprintf(stderr, "wcet: no function %s\n", name);
+				cycles = -1;
+			}
+			else if(at) {
+				loopSize = 0;
+				loopIter = -1;
+				analyze(fn, 1);
+				cycles = failed ? -1 : loopIter;
+			}
+			else
+				cycles = wcet(fn);
+
+			if(cycles < 0 || failed) {
+				printf(" %18s", "?");
+				over = 1;
+			}
+			else {
+				printf(" %18ld", cycles);
+				if(budget[r] >= 0 && cycles > budget[r])
+					over = 1;
+			}
+		}
+		printf("\n");
+	}
+
+	printf("%-12s", "budget");
+	for(r = 0; r < roots; r++) {
+		if(budget[r] >= 0)
+			printf(" %18ld", budget[r]);
+		else
+			printf(" %18s", "-");
+	}
+	printf("\n");
+
+	if(over)
+		fprintf(stderr, "wcet: %s is over budget or could not be analyzed\n", argv[a]);
+	return over;
+}